@@ -24,49 +24,58 @@
 
 // File: main.cc
 
-#include <ilang/ilang++.h>
-#include <ilang/target-smt/smt_shim.h>
-#include <ilang/target-smt/smt_switch_itf.h>
-#include <ilang/target-smt/z3_expr_adapter.h>
+#include <string>
 
-#ifdef USE_Z3
-#include <z3++.h>
-#else
-#include <smt-switch/boolector_factory.h>
-#include <smt-switch/smt.h>
-#endif
+#include <ilang/ilang++.h>
 
-#include <pffc/ischecker_flex_relay.h>
+#include <pffc/bench.h>
+#include <pffc/job.h>
+#include <pffc/journal.h>
+#include <pffc/server.h>
 
 using namespace ilang;
 
-int main() {
+// usage:
+//   pffc                            check the small fragment in ../data
+//   pffc <job.json>                 check the job
+//   pffc --serve <spool> [workers]  serve jobs from the spool directory
+//   pffc --campaign <journal> <job.json>...
+//                                   check the jobs, resume from the journal
+//   pffc --bench <corpus> <baseline> [--record]
+//                                   compare the corpus against the baseline
+int main(int argc, char** argv) {
   EnableDebug("3LA");
 
-  auto data_dir = fs::current_path() / ".." / "data";
-
-#ifdef USE_Z3
-  z3::context ctx;
-  auto smt_generator = Z3ExprAdapter(ctx);
-#else
-  auto btor = smt::BoolectorSolverFactory::create(false);
-  auto smt_generator = SmtSwitchItf(btor);
-#endif
+  if (argc > 3 && std::string(argv[1]) == "--campaign") {
+    Journal journal(argv[2]);
+    auto num_fail = 0;
+    for (auto i = 3; i < argc; i++) {
+      CheckStat stat;
+      num_fail += !RunJob(ReadJob(argv[i]), stat, nullptr, &journal);
+    }
+    return num_fail ? 1 : 0;
+  }
 
-  auto smt_shim = SmtShim(smt_generator);
-  auto checker = IsCheckerFlexRelay(smt_shim);
+  if (argc > 3 && std::string(argv[1]) == "--bench") {
+    auto record = (argc > 4) && std::string(argv[4]) == "--record";
+    auto num_regress = RunBench(argv[2], argv[3], record);
+    return num_regress ? 1 : 0;
+  }
 
-  // instruction sequence to verify
-  checker.SetInstrSeq(0, data_dir / "instr_seq_flex_small.json");
-  checker.SetInstrSeq(1, data_dir / "instr_seq_relay_small.json");
+  if (argc > 2 && std::string(argv[1]) == "--serve") {
+    auto num_worker = (argc > 3) ? std::stoi(argv[3]) : 1;
+    JobServer server(argv[2], num_worker);
+    server.Serve();
+    return 0;
+  }
 
-  // design specific
-  checker.SetFlexCmd(data_dir / "prog_frag_flex.json");
-  checker.SetRelayCmd(data_dir / "prog_frag_relay.json");
-  checker.SetAddrMapping(data_dir / "addr_mapping.json");
+  // job description from file, or the default one on the small fragment
+  auto job = (argc > 1) ? ReadJob(argv[1])
+                        : GetDefaultJob(fs::current_path() / ".." / "data");
 
   // verify
-  checker.Check();
+  CheckStat stat;
+  RunJob(job, stat);
 
   return 0;
 }
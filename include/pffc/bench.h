@@ -0,0 +1,77 @@
+// =============================================================================
+// MIT License
+//
+// Copyright (c) 2020 Princeton University
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+
+// File: bench.h
+
+#ifndef PFFC_BENCH_H__
+#define PFFC_BENCH_H__
+
+#include <filesystem>
+#include <map>
+#include <string>
+
+#include <pffc/job.h>
+#include <pffc/stat.h>
+
+namespace fs = std::filesystem;
+
+namespace ilang {
+
+// allowed deviation from the baseline
+struct BenchTolerance {
+  // time of a phase: ratio, and absolute difference (s) below which it is noise
+  double time = 1.5;
+  double min_time = 0.5;
+  // expression nodes: relative increase
+  double node = 0.1;
+  // peak memory: ratio
+  double peak_mem = 1.3;
+};
+
+// verdict and per-phase metrics of one job
+struct BenchRecord {
+  std::string result;
+  std::map<std::string, double> metric;
+};
+
+// Regression benchmark on a corpus of jobs, i.e., {"jobs": [<job.json>, ...]}
+// (paths relative to the corpus file), against the recorded baseline, i.e.,
+// {"revision": {"flex": .., "relay": ..}, "tolerance": {...},
+//  "jobs": {<name>: {"result": .., "metric": {..}}}}.
+// Each job runs in a child process (for its own peak memory). Returns the
+// number of regressions (a baseline of other model revisions counts as one),
+// or records the baseline instead if requested.
+int RunBench(const fs::path& corpus, const fs::path& baseline,
+             const bool& record);
+
+// per-phase metrics of a check
+std::map<std::string, double> GetBenchMetric(const CheckStat& stat);
+
+// whether the metric regressed from the baseline beyond the tolerance
+bool IsRegressed(const std::string& name, const double& base,
+                 const double& curr, const BenchTolerance& tol);
+
+} // namespace ilang
+
+#endif // PFFC_BENCH_H__
@@ -0,0 +1,73 @@
+// =============================================================================
+// MIT License
+//
+// Copyright (c) 2020 Princeton University
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+
+// File: cmd_expr.h
+
+#ifndef PFFC_CMD_EXPR_H__
+#define PFFC_CMD_EXPR_H__
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <ilang/ilang++.h>
+
+namespace ilang {
+
+// Memoized builder of command constraints, i.e., conjunctions of input port
+// equalities. Ports are resolved once, and identical field constraints and
+// commands share the same expression, so the expressions grow with the
+// distinct commands rather than with all commands.
+class CmdExprBuilder {
+public:
+  // (input port, value) pairs of a command, in the order conjoined
+  typedef std::vector<std::pair<std::string, unsigned long long>> FieldVec;
+
+  // constructor (on the flattened model)
+  CmdExprBuilder(const Ila& m) : m_(m) {}
+
+  // input port
+  ExprRef Input(const std::string& name);
+  // input == value
+  ExprRef Field(const std::string& name, const unsigned long long& value);
+  // conjunction of the field constraints
+  ExprRef Command(const FieldVec& fields);
+
+  // number of commands built, and distinct ones among them
+  inline size_t num_cmd() const { return num_cmd_; }
+  inline size_t num_distinct_cmd() const { return cmds_.size(); }
+
+private:
+  Ila m_;
+  std::map<std::string, ExprRef> inputs_;
+  std::map<std::pair<std::string, unsigned long long>, ExprRef> fields_;
+  std::map<FieldVec, ExprRef> cmds_;
+  size_t num_cmd_ = 0;
+
+}; // class CmdExprBuilder
+
+} // namespace ilang
+
+#endif // PFFC_CMD_EXPR_H__
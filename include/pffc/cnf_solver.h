@@ -0,0 +1,94 @@
+// =============================================================================
+// MIT License
+//
+// Copyright (c) 2020 Princeton University
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+
+// File: cnf_solver.h
+
+#ifndef PFFC_CNF_SOLVER_H__
+#define PFFC_CNF_SOLVER_H__
+
+#ifdef USE_Z3
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <z3++.h>
+
+#include <pffc/solver.h>
+
+namespace fs = std::filesystem;
+
+namespace ilang {
+
+// bit-blast a bit-vector query (via AIG) to DIMACS CNF and solve it with an
+// external SAT solver, e.g., "kissat -q" (the CNF file is the last argument)
+//
+// Memories and quantified axioms are abstracted first, by relating memories
+// only at the addresses read and instantiating the axioms at the applications
+// of their functions. The abstraction only weakens the query, so UNSAT is a
+// proof while SAT is inconclusive.
+class CnfSolver {
+public:
+  // constructor, CNF files are kept in the cache directory if given, and the
+  // time limit (ms, 0 for none) bounds both the encoding and the SAT solver
+  CnfSolver(z3::context& ctx, const std::string& cmd,
+            const fs::path& cache_dir = "", const unsigned& timeout = 0);
+
+  // add assertion
+  inline void Add(const z3::expr& expr) { query_.push_back(expr); }
+  // check satisfiability of the assertions, unknown if not bit-blastable
+  SmtResult Check();
+
+  // statistics of the last check
+  inline bool cache_hit() const { return cache_hit_; }
+  inline double cnf_time() const { return cnf_time_; }
+  inline double sat_time() const { return sat_time_; }
+
+private:
+  z3::context& ctx_;
+  std::string cmd_;
+  fs::path cache_dir_;
+  unsigned timeout_;
+  std::vector<z3::expr> query_;
+
+  bool cache_hit_ = false;
+  double cnf_time_ = 0;
+  double sat_time_ = 0;
+
+  // key of the query (content hash of its SMT-LIB text)
+  std::string GetQueryKey() const;
+  // AIG rewriting and Tseitin encoding, returns false if not pure bit-vector
+  bool ToCnf(const fs::path& file) const;
+  // memory and axiom abstraction of the (simplified) assertions in place
+  void Abstract(std::vector<z3::expr>& query) const;
+  // run the external solver (without a shell) on the CNF file
+  SmtResult RunSat(const fs::path& file) const;
+
+}; // class CnfSolver
+
+} // namespace ilang
+
+#endif // USE_Z3
+
+#endif // PFFC_CNF_SOLVER_H__
@@ -27,50 +27,179 @@
 #ifndef PFFC_ISCHECKER_H__
 #define PFFC_ISCHECKER_H__
 
+#include <algorithm>
 #include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
 #include <set>
 #include <string>
+#include <tuple>
+#include <utility>
 #include <vector>
 
 #include <ilang/ila-mngr/u_unroller_smt.h>
 #include <ilang/ilang++.h>
 #include <ilang/target-smt/smt_shim.h>
 
+#include <pffc/journal.h>
+#include <pffc/solver.h>
+#include <pffc/stat.h>
+
 namespace fs = std::filesystem;
 
 namespace ilang {
 
+// model with flattened hierarchy (can be reused across checks)
+struct FlatIla {
+  Ila model;
+  // top-level instructions before flattening
+  std::set<std::string> top_instr;
+};
+
+// bookkeep the top-level instructions and flatten the hierarchy
+FlatIla FlattenIla(const Ila& m);
+
+// apply the optimization passes in order and record their effect
+void ApplyPasses(Ila& m, const int& idx, const std::vector<std::string>& passes,
+                 std::vector<PassStat>& stat);
+
+// count unique expression nodes of the decode/update functions
+size_t GetExprNodeNum(const Ila& m);
+
 template <class Generator> class IsChecker {
 public:
-  // constructor and destructor
-  IsChecker(const Ila& m0, const Ila& m1, SmtShim<Generator>& smt_gen);
-  ~IsChecker();
+  // constructor - two or more models (e.g., ISA levels) checked pairwise
+  IsChecker(const std::vector<Ila>& models, SmtShim<Generator>& smt_gen);
+  IsChecker(const std::vector<FlatIla>& models, SmtShim<Generator>& smt_gen);
+  IsChecker(const Ila& m0, const Ila& m1, SmtShim<Generator>& smt_gen)
+      : IsChecker(std::vector<Ila>{m0, m1}, smt_gen) {}
+  IsChecker(const FlatIla& m0, const FlatIla& m1, SmtShim<Generator>& smt_gen)
+      : IsChecker(std::vector<FlatIla>{m0, m1}, smt_gen) {}
 
   // start checking
   bool Check();
 
-  // specify the instruction sequence (file) of m0/m1
+  // specify the instruction sequence (file) of the model at idx
   void SetInstrSeq(const int& idx, const fs::path& file);
 
+  // specify the optimization passes (applied in order before unrolling)
+  void SetPasses(const std::vector<std::string>& passes);
+
+  // check segment by segment (split at design specific boundaries)
+  inline void SetCompositional(const bool& enable) { compositional_ = enable; }
+
+  // prove the loop (repeated iterations) of the sequences by k-induction on
+  // the design specific invariant, 0 for none
+  inline void SetInduction(const unsigned& k) { induction_ = k; }
+
+  // check the obligations one by one and record them in the journal (keys
+  // prefixed, e.g., by the job), skipping the ones already finished
+  inline void SetJournal(Journal* journal, const std::string& prefix) {
+    journal_ = journal;
+    journal_prefix_ = prefix;
+  }
+
+  // check the obligations one by one, and solve one of each group of
+  // obligations that are equal up to renaming (z3 only)
+  inline void SetMergeObligation(const bool& enable) {
+    merge_obligation_ = enable;
+  }
+
+  // check the obligations one by one, reusing the verdicts of the run recorded
+  // in the state file where the inputs of the query did not change, and
+  // record this run in it
+  inline void SetIncremental(const fs::path& state) { incremental_ = state; }
+
+  // time limit (ms) of each solver query, 0 for none
+  inline void SetTimeout(const unsigned& timeout) { timeout_ = timeout; }
+
+  // number of threads unrolling the models (z3 only), 1 for sequential
+  inline void SetUnrollThread(const unsigned& num) {
+    unroll_thread_ = std::max(num, 1u);
+  }
+
+  // number of threads solving the segments (z3 only), 1 for sequential
+  inline void SetSegmentThread(const unsigned& num) {
+    segment_thread_ = std::max(num, 1u);
+  }
+
+  // solve bit-blasted queries with an external SAT solver (z3 only), and
+  // keep the CNF files in the cache directory if given
+  inline void SetSatSolver(const std::string& cmd, const fs::path& cache_dir) {
+    sat_cmd_ = cmd;
+    cnf_cache_ = cache_dir;
+  }
+
+  // split the query into 2^bits cubes on the top bits of the design specific
+  // split variables, solved by the given number of threads (z3 only)
+  inline void SetCube(const unsigned& bits, const unsigned& num_thread) {
+    cube_bits_ = bits;
+    cube_thread_ = num_thread;
+  }
+
+  // statistics of the last check
+  inline const CheckStat& stat() const { return stat_; }
+
 protected:
   // SMT generator smt_gen_;
   SmtShim<Generator>& smt_gen_;
 
-  // ILA model to check
-  Ila m0_;
-  Ila m1_;
+  // ILA models to check (indexed as below)
+  std::vector<Ila> m_;
+
+  // instruction sequence of each model
+  std::vector<std::vector<InstrRef>> instr_seq_;
+
+  // design info - top-level instructions of each model
+  std::vector<std::set<std::string>> top_instr_;
+
+  // design specific constraints of each model, i.e., (constraint, step)
+  typedef std::vector<std::pair<ExprRef, size_t>> EnvType;
+  std::vector<EnvType> env_;
+
+  // optimization passes
+  std::vector<std::string> passes_;
+
+  // compositional checking
+  bool compositional_ = false;
+
+  // k-induction depth
+  unsigned induction_ = 0;
+
+  // campaign journal
+  Journal* journal_ = nullptr;
+  std::string journal_prefix_;
+
+  // merging equivalent obligations
+  bool merge_obligation_ = false;
+
+  // incremental re-verification state file
+  fs::path incremental_;
+
+  // solver time limit (ms)
+  unsigned timeout_ = 0;
+
+  // unrolling threads
+  unsigned unroll_thread_ = 1;
+
+  // segment solving threads
+  unsigned segment_thread_ = 1;
+
+  // external SAT solver
+  std::string sat_cmd_;
+  fs::path cnf_cache_;
 
-  // instruction sequence
-  std::vector<InstrRef> instr_seq_m0_;
-  std::vector<InstrRef> instr_seq_m1_;
+  // cube-and-conquer
+  unsigned cube_bits_ = 0;
+  unsigned cube_thread_ = 0;
 
-  // design info - top-level instructions
-  std::set<std::string> top_instr_m0_;
-  std::set<std::string> top_instr_m1_;
+  // statistics
+  CheckStat stat_;
 
-  // instruction sequence unroller (for z3)
-  PathUnroller<Generator>* unroller_m0_ = nullptr;
-  PathUnroller<Generator>* unroller_m1_ = nullptr;
+  // unroller of each model for referring to the states at given steps (e.g.,
+  // in the miter)
+  std::vector<std::unique_ptr<PathUnroller<Generator>>> unroller_;
 
   // preprocessing before checking, e.g., flattening hierarchy
   void Preprocess();
@@ -78,22 +207,185 @@ protected:
   typedef decltype(smt_gen_.GetShimExpr(nullptr, "")) SmtExpr;
   // typedef decltype(smt_gen_.GetShimFunc(nullptr)) SmtFunc;
 
+  // steps [begin[i], end[i]) of each model i, checked against each other
+  struct Segment {
+    std::vector<size_t> begin;
+    std::vector<size_t> end;
+  };
+
+  // iterations [begin[i] + j * period[i], begin[i] + (j + 1) * period[i]) for
+  // j < num_iter that have the same instructions and constraints in model i
+  struct Loop {
+    std::vector<size_t> begin;
+    std::vector<size_t> period;
+    size_t num_iter;
+  };
+
+  // part of the property, violated if the query is sat
+  struct Obligation {
+    std::string name;
+    SmtExpr violation;
+  };
+
+  // inputs and verdicts of a run (incremental re-verification)
+  struct RunState {
+    // signature (instruction and constraints, hashed) of each step per model
+    std::vector<std::vector<std::string>> step;
+    // model identity ("model:" keys, e.g., passes and revisions) and design
+    // specific inputs, e.g., the address mapping
+    std::map<std::string, std::string> extra;
+    // obligation -> (result, query fingerprint)
+    std::map<std::string, std::pair<std::string, std::string>> verdict;
+  };
+
   // design specific
-  virtual void AddEnvM0() {}
-  virtual void AddEnvM1() {}
-  virtual SmtExpr GetMiter() = 0;
+  virtual void AddEnv(const size_t& idx) {}
+  virtual SmtExpr GetPairMiter(const size_t& i, const size_t& j) = 0;
   virtual SmtExpr GetUninterpFunc() = 0;
 #ifdef USE_Z3
   virtual void Debug(z3::model& model) {}
 #endif
 
+  // design specific - pairs of models compared (adjacent levels by default)
+  virtual std::vector<std::pair<size_t, size_t>> GetMiterPairs();
+
+  // design specific - the miter split into obligations (checked under the
+  // assumption of the whole sequences as one segment), one per pair
+  virtual std::vector<Obligation> GetObligations();
+  // counterexample summary, e.g., for the journal
+  virtual std::string GetWitness(Solver<Generator>& solver);
+
+  // design specific - inputs of the queries other than the steps ("model:"
+  // keys for the identity of the models, affecting all obligations)
+  virtual std::map<std::string, std::string> GetExtraInput() { return {}; }
+  // design specific - obligations affected by the changed steps (of each
+  // model) and extra inputs (other than "model:" ones), the others are reused
+  // if their query is the same
+  virtual std::set<std::string>
+  GetAffectedObligations(const std::vector<std::set<size_t>>& steps,
+                         const std::set<std::string>& extra) {
+    return {};
+  }
+
+  // design specific - variables whose top bits split the query into cubes
+  virtual std::vector<SmtExpr> GetSplitVar() { return {}; }
+
+  // design specific - relation kept at the loop iteration boundaries
+  virtual SmtExpr GetInvariant(const std::vector<size_t>& steps) {
+    return smt_gen_.GetShimExpr(BoolConst(true).get());
+  }
+
+  // design specific - compositional checking
+  virtual std::vector<Segment> GetSegments() { return {}; }
+  // relation assumed at the segment start (from the initial state if first)
+  virtual SmtExpr GetSegmentAssumption(const Segment& seg, const bool& first) {
+    return smt_gen_.GetShimExpr(BoolConst(true).get());
+  }
+  // violation of the relation at the segment end
+  virtual SmtExpr GetSegmentViolation(const Segment& seg) {
+    return smt_gen_.GetShimExpr(BoolConst(false).get());
+  }
+
+  // violated if any pair of models differs
+  SmtExpr GetMiter();
+
+  // the whole sequences as one segment
+  Segment GetWholeSegment() const;
+
+  // unroll the steps of the segment, returns the transitions of each model
+  // (each model is unrolled once, whatever the number of pairs)
+  std::vector<SmtExpr> UnrollSegment(const Segment& seg);
+#ifdef USE_Z3
+  // unroll chunks of the segment in separate contexts and translate back
+  std::vector<SmtExpr> UnrollParallel(const Segment& seg);
+#endif
+
+  // check the whole sequences at once
+  SmtResult CheckMonolithic();
+
+#ifdef USE_Z3
+  // solve the cubes of the query in parallel, stop at the first sat cube
+  SmtResult CheckCube(const std::vector<SmtExpr>& query,
+                      const std::vector<SmtExpr>& vars);
+#endif
+
+  // check the loop by k-induction, and the steps before/after it
+  SmtResult CheckInductive(const Loop& loop);
+  // the loop covering the most steps (num_iter is 0 if none)
+  Loop GetLoop();
+  // helper - instruction and constraints (step-independent) of each step
+  std::vector<size_t> GetStepSignature(const std::vector<InstrRef>& seq,
+                                       const EnvType& env,
+                                       std::map<std::string, size_t>& ids);
+  // helper - longest part of the step signatures repeating with a period,
+  // i.e., (begin, period, repetition), all 0 if none repeats twice
+  static std::tuple<size_t, size_t, size_t>
+  FindPeriodic(const std::vector<size_t>& sig);
+
+  // check the obligations one by one, skipping the finished ones
+  SmtResult CheckObligations();
+  // groups (of indices in todo) of obligations sharing the verdict, by the
+  // query fingerprint of each (taken from fingerprint if there, and added)
+  std::vector<std::vector<size_t>>
+  GroupObligations(const std::vector<Obligation>& obligations,
+                   const std::vector<size_t>& todo,
+                   const std::vector<SmtExpr>& base,
+                   std::map<size_t, std::string>& fingerprint);
+
+  // inputs of this run (no verdict)
+  RunState GetRunState();
+  // obligations affected by the changes of the inputs since the previous run
+  // (all if the models changed)
+  std::set<std::string> GetAffected(const RunState& prev, const RunState& curr,
+                                    const std::vector<Obligation>& obligations);
+  // fingerprint of the obligation query (simplified and renamed, see
+  // GroupObligations), empty if not supported
+  std::string GetQueryFingerprint(const std::vector<SmtExpr>& base,
+                                  const SmtExpr& violation);
+  // helper - changed steps (by position, per model) and extra inputs (added,
+  // removed or changed) of the current run
+  static std::pair<std::vector<std::set<size_t>>, std::set<std::string>>
+  DiffRunState(const RunState& prev, const RunState& curr);
+  // helper - read/write the state file (empty state if missing)
+  static RunState ReadRunState(const fs::path& file);
+  static void WriteRunState(const fs::path& file, const RunState& state);
+
+  // check the segments one by one, chained by the segment relation
+  SmtResult CheckCompositional(const std::vector<Segment>& segments);
+  // build the query of each segment in order, given to check (with the
+  // violation) until it returns false
+  void BuildSegmentQuery(
+      const std::vector<Segment>& segments,
+      const std::function<bool(const size_t&, Solver<Generator>&)>& check);
+#ifdef USE_Z3
+  // solve the segment queries in parallel as soon as they are built
+  SmtResult CheckSegmentParallel(const std::vector<Segment>& segments);
+#endif
+  bool IsValidSegmentation(const std::vector<Segment>& segments) const;
+  // constant-valued non-memory states at the given steps (as equalities)
+  std::vector<SmtExpr> GetConstControlState(Solver<Generator>& solver,
+                                            const std::vector<size_t>& steps);
+
+  // record the query on the steps of the segment in the statistics
+  void RecordQuery(const std::string& name, const Segment& seg,
+                   const SmtResult& res, const double& time,
+                   const SolverStat& solver_stat);
+
+  // helper - assert the constraints with step in [begin, end) to the unroller
+  static void AssertEnv(PathUnroller<Generator>& unroller, const EnvType& env,
+                        const size_t& begin, const size_t& end);
+  // helper - instructions of steps [begin, end)
+  static InstrVec GetInstrVec(const std::vector<InstrRef>& seq,
+                              const size_t& begin, const size_t& end);
+
+  // helper - boolean connectives not provided by the shim
+  SmtExpr BoolNot(const SmtExpr& a);
+  SmtExpr BoolOr(const SmtExpr& a, const SmtExpr& b);
+
   // helper - read instruction sequence from file
   static void ReadInstrSeq(const Ila& m, const fs::path& file,
                            std::vector<InstrRef>& dst);
 
-  // helper - collect top-level instructions
-  static void GetTopInstr(const Ila& m, std::set<std::string>& dst);
-
 }; // class IsChecker
 
 } // namespace ilang
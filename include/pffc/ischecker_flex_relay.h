@@ -27,11 +27,14 @@
 #ifndef PFFC_ISCHECKER_FLEX_RELAY_H__
 #define PFFC_ISCHECKER_FLEX_RELAY_H__
 
+#include <map>
+#include <set>
 #include <tuple>
 
 #include <flex/interface.h>
 #include <relay/interface.h>
 
+#include <pffc/cmd_expr.h>
 #include <pffc/ischecker.h>
 
 namespace ilang {
@@ -41,19 +44,58 @@ class IsCheckerFlexRelay : public IsChecker<Generator> {
 public:
   IsCheckerFlexRelay(SmtShim<Generator>& gen)
       : IsChecker<Generator>(flex::GetFlexIla(), relay::GetRelayIla(), gen) {}
+  IsCheckerFlexRelay(const FlatIla& flex, const FlatIla& relay,
+                     SmtShim<Generator>& gen)
+      : IsChecker<Generator>(flex, relay, gen) {}
 
   void SetFlexCmd(const fs::path& cmd_file);
   void SetRelayCmd(const fs::path& cmd_file);
   void SetAddrMapping(const fs::path& mapping);
 
+  // prove the end-state relation once per affine address range
+  inline void SetParametricAddr(const bool& enable) {
+    parametric_addr_ = enable;
+  }
+
 protected:
-  void AddEnvM0();
-  void AddEnvM1();
-  typename IsChecker<Generator>::SmtExpr GetMiter();
+  // model 0 is Flex, model 1 is Relay
+  void AddEnv(const size_t& idx);
+  typename IsChecker<Generator>::SmtExpr GetPairMiter(const size_t& i,
+                                                      const size_t& j);
   typename IsChecker<Generator>::SmtExpr GetUninterpFunc();
 #ifdef USE_Z3
   void Debug(z3::model& model);
 #endif
+  std::vector<typename IsChecker<Generator>::Obligation> GetObligations();
+  std::vector<typename IsChecker<Generator>::SmtExpr> GetSplitVar();
+  // incremental - address mapping and model revisions, and obligations of the
+  // changed stores
+  std::map<std::string, std::string> GetExtraInput();
+  std::set<std::string>
+  GetAffectedObligations(const std::vector<std::set<size_t>>& steps,
+                         const std::set<std::string>& extra);
+  typename IsChecker<Generator>::SmtExpr
+  GetInvariant(const std::vector<size_t>& steps);
+
+  // compositional - one segment per (group of) Relay function call
+  std::vector<typename IsChecker<Generator>::Segment> GetSegments();
+  typename IsChecker<Generator>::SmtExpr
+  GetSegmentAssumption(const typename IsChecker<Generator>::Segment& seg,
+                       const bool& first);
+  typename IsChecker<Generator>::SmtExpr
+  GetSegmentViolation(const typename IsChecker<Generator>::Segment& seg);
+
+  // affine address range, i.e., flex_addr + i -> relay_addr + i for i < size
+  struct AddrRange {
+    size_t flex_addr;
+    size_t relay_addr;
+    size_t size;
+  };
+
+  // helper - (flex, relay) address pairs, in order, merged into maximal
+  // affine ranges
+  static std::vector<AddrRange>
+  GetAffineRange(const std::vector<std::pair<size_t, size_t>>& addr_pairs);
 
 private:
   typedef std::map<std::string, unsigned long long> CmdType;
@@ -63,11 +105,49 @@ private:
   std::vector<CmdType> cmd_seq_flex_;
   std::vector<CmdType> cmd_seq_relay_;
   std::map<size_t, size_t> addr_mapping_;
+  // stored address -> step of the store
   std::map<size_t, size_t> store_flex_;
   std::map<size_t, size_t> store_relay_;
-
-  ExprRef FilterFlexCmd(const std::string& name, size_t cmd_idx);
-  ExprRef FilterRelayCmd(const std::string& name, size_t cmd_idx);
+  // LSTM hidden/cell state (flex -> relay address), and the LSTM call steps
+  std::map<size_t, size_t> lstm_mapping_;
+  std::set<size_t> lstm_relay_;
+
+  bool parametric_addr_ = false;
+  // symbolic address index (one per range) in flex and relay
+  std::vector<std::pair<ExprRef, ExprRef>> addr_idx_;
+
+  void AddFlexEnv();
+  void AddRelayEnv();
+  // constraint of the command at the step (stores are recorded)
+  ExprRef FilterFlexCmd(CmdExprBuilder& builder, const std::string& name,
+                        size_t cmd_idx, size_t step);
+  ExprRef FilterRelayCmd(CmdExprBuilder& builder, const std::string& name,
+                         size_t cmd_idx, size_t step);
+
+  // segment boundaries (steps)
+  std::vector<size_t> GetFlexSegmentStart();
+  std::vector<size_t> GetRelaySegmentStart();
+
+  // memory relation - initial state, stored data, and end state
+  typename IsChecker<Generator>::SmtExpr GetStartRelation();
+  typename IsChecker<Generator>::SmtExpr
+  GetStoreRelation(const size_t& flex_begin, const size_t& flex_end,
+                   const size_t& relay_begin, const size_t& relay_end);
+  typename IsChecker<Generator>::SmtExpr
+  GetEndRelation(const size_t& flex_step, const size_t& relay_step);
+  typename IsChecker<Generator>::SmtExpr
+  GetAddrRelation(const size_t& flex_addr, const size_t& flex_step,
+                  const size_t& relay_step);
+  // hidden/cell state relation at the boundary of LSTM timesteps
+  typename IsChecker<Generator>::SmtExpr
+  GetLstmRelation(const size_t& flex_step, const size_t& relay_step);
+  typename IsChecker<Generator>::SmtExpr
+  GetEndViolation(const size_t& flex_step, const size_t& relay_step);
+
+  // end-state difference over symbolic addresses within each affine range
+  typename IsChecker<Generator>::SmtExpr
+  GetParametricEndDiff(const size_t& flex_end, const size_t& relay_end);
+  std::pair<ExprRef, ExprRef> GetAddrIdx(const size_t& range_idx);
 
   // helper - remove "0x" prefix if exist
   inline std::string RemoveHexPrefix(const std::string& org) {
@@ -0,0 +1,140 @@
+// =============================================================================
+// MIT License
+//
+// Copyright (c) 2020 Princeton University
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+
+// File: job.h
+
+#ifndef PFFC_JOB_H__
+#define PFFC_JOB_H__
+
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <pffc/ischecker.h>
+#include <pffc/journal.h>
+#include <pffc/stat.h>
+
+namespace fs = std::filesystem;
+
+namespace ilang {
+
+// description of one Flex/Relay checking job
+struct Job {
+  // job name (for reporting)
+  std::string name;
+
+  // instruction sequences
+  fs::path instr_seq_flex;
+  fs::path instr_seq_relay;
+
+  // design specific inputs
+  fs::path cmd_flex;
+  fs::path cmd_relay;
+  fs::path addr_mapping;
+
+  // optimization passes applied before unrolling
+  std::vector<std::string> passes;
+
+  // prove the end-state relation over symbolic addresses in affine ranges
+  bool parametric_addr = false;
+
+  // check segment by segment (one per group of Relay function calls)
+  bool compositional = false;
+  // threads solving the segments (z3 only)
+  unsigned segment_thread = 1;
+
+  // k-induction depth for the loop in the sequences (0 for none)
+  unsigned induction = 0;
+
+  // check the obligations one by one, once per group equal up to renaming
+  bool merge_obligations = false;
+
+  // threads unrolling the instruction sequences (z3 only)
+  unsigned unroll_thread = 1;
+
+  // external SAT solver command (empty for none) and CNF cache directory
+  std::string sat_solver;
+  fs::path cnf_cache;
+
+  // cube-and-conquer split bits (0 for none) and threads (0 for all cores)
+  unsigned cube_bits = 0;
+  unsigned cube_thread = 0;
+
+  // state file of incremental re-verification (verdicts of the previous run
+  // reused for unchanged queries), none if empty
+  fs::path incremental;
+
+  // statistics output (per-query solver statistics), none if empty
+  fs::path stat_out;
+
+  // scheduling priority (higher first) and solver time limit in seconds
+  int priority = 0;
+  unsigned timeout = 0;
+};
+
+// flattened Flex/Relay models kept across jobs (one set per pass list)
+class ModelCache {
+public:
+  // models with the passes applied (built on first request)
+  const std::pair<FlatIla, FlatIla>&
+  Get(const std::vector<std::string>& passes);
+
+private:
+  std::map<std::vector<std::string>, std::pair<FlatIla, FlatIla>> models_;
+
+}; // class ModelCache
+
+// read the job description from file (paths are relative to the file)
+Job ReadJob(const fs::path& file);
+
+// the default job on the small program fragment in the data directory
+Job GetDefaultJob(const fs::path& data_dir);
+
+// check if all input files of the job exist
+bool HasJobInput(const Job& job);
+
+// fingerprint (content hash) of the job inputs, the settings affecting the
+// verdicts and the revisions of the built-in models
+std::string GetJobFingerprint(const Job& job);
+
+// run the job and collect the statistics, return true if verified
+// (models are taken from the cache if provided, otherwise built from scratch,
+// and obligations are recorded in the journal if provided)
+bool RunJob(const Job& job, CheckStat& stat, ModelCache* cache = nullptr,
+            Journal* journal = nullptr);
+
+// run the job in a child process, so that a failing assertion (fatal) or a
+// crash only ends the child, and return the report made by the child from
+// the verdict and statistics (null if the child did not complete)
+nlohmann::json RunJobIsolated(
+    const Job& job,
+    const std::function<nlohmann::json(const bool&, const CheckStat&)>& report,
+    ModelCache* cache = nullptr);
+
+} // namespace ilang
+
+#endif // PFFC_JOB_H__
@@ -0,0 +1,85 @@
+// =============================================================================
+// MIT License
+//
+// Copyright (c) 2020 Princeton University
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+
+// File: journal.h
+
+#ifndef PFFC_JOURNAL_H__
+#define PFFC_JOURNAL_H__
+
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+namespace fs = std::filesystem;
+
+namespace ilang {
+
+// Append-only journal of a verification campaign (one JSON object per line):
+//   {"event": "start", "key": ..}
+//   {"event": "done", "key": .., "result": .., "time": .., "witness": ..}
+// Finished obligations (sat/unsat) are skipped on resume, while the ones
+// started but not finished (e.g., interrupted by a reboot) or finished with an
+// unknown verdict (e.g., timeout) are checked again.
+class Journal {
+public:
+  // verdict of a finished obligation
+  struct Record {
+    std::string result;
+    double time = 0;
+    std::string witness;
+  };
+
+  // constructor, load the existing records
+  Journal(const fs::path& file);
+
+  // record of the finished obligation, nullptr if not finished
+  const Record* Find(const std::string& key) const;
+
+  // mark the obligation started/finished
+  void Start(const std::string& key);
+  void Done(const std::string& key, const Record& rec);
+
+  // number of finished obligations
+  inline size_t num_done() const { return done_.size(); }
+
+  // helper - whether the verdict is final (sat/unsat)
+  static bool IsConclusive(const Record& rec);
+
+private:
+  fs::path file_;
+  std::map<std::string, Record> done_;
+  std::mutex mtx_;
+
+  // append one line and flush
+  void Append(const nlohmann::json& entry);
+
+}; // class Journal
+
+} // namespace ilang
+
+#endif // PFFC_JOURNAL_H__
@@ -0,0 +1,108 @@
+// =============================================================================
+// MIT License
+//
+// Copyright (c) 2020 Princeton University
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+
+// File: server.h
+
+#ifndef PFFC_SERVER_H__
+#define PFFC_SERVER_H__
+
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <queue>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include <pffc/job.h>
+#include <pffc/stat.h>
+
+namespace fs = std::filesystem;
+
+namespace ilang {
+
+// Long-running job server on a spool directory:
+//   queue/          job descriptions to check (*.json, renamed in when ready)
+//   running/        jobs being checked (each in a child process), and the
+//                   number of times each was started (*.attempt)
+//   done/           finished jobs and their results (*.result.json)
+//   failed/         job descriptions that cannot be read, or that were
+//                   interrupted (e.g., by a crash) too many times
+//   results.jsonl   results (with metrics) in the order of completion
+//   stop            stop the server (running jobs are completed)
+class JobServer {
+public:
+  // constructor
+  JobServer(const fs::path& spool, const int& num_worker);
+
+  // serve until the stop file appears
+  void Serve();
+
+private:
+  // queued job
+  struct Entry {
+    Job job;
+    fs::path file;
+    size_t seq;
+    Timer enqueued;
+  };
+
+  // higher priority first, then first-come first-served
+  struct EntryCmp {
+    bool operator()(const Entry& a, const Entry& b) const {
+      if (a.job.priority != b.job.priority) {
+        return a.job.priority < b.job.priority;
+      }
+      return a.seq > b.seq;
+    }
+  };
+
+  fs::path spool_;
+  int num_worker_;
+
+  std::priority_queue<Entry, std::vector<Entry>, EntryCmp> queue_;
+  // files in the queue directory that are already queued
+  std::set<fs::path> known_;
+  size_t seq_ = 0;
+  bool stop_ = false;
+  std::mutex queue_mtx_;
+  std::condition_variable queue_cv_;
+
+  std::mutex result_mtx_;
+
+  // pick up new job descriptions
+  void Poll();
+  // worker loop (with its own warm models)
+  void Work(const int& id);
+  // write out the result of a finished job
+  void Report(const Entry& entry, const int& worker, const bool& verified,
+              const nlohmann::json& stat, const double& wait);
+
+}; // class JobServer
+
+} // namespace ilang
+
+#endif // PFFC_SERVER_H__
@@ -0,0 +1,124 @@
+// =============================================================================
+// MIT License
+//
+// Copyright (c) 2020 Princeton University
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+
+// File: solver.h
+
+#ifndef PFFC_SOLVER_H__
+#define PFFC_SOLVER_H__
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+
+#include <ilang/target-smt/smt_shim.h>
+
+#ifdef USE_Z3
+#include <z3++.h>
+#else
+#include <smt-switch/smt.h>
+#endif
+
+namespace ilang {
+
+// result of a satisfiability query
+enum class SmtResult { SAT, UNSAT, UNKNOWN };
+
+inline std::string ToString(const SmtResult& res) {
+  switch (res) {
+  case SmtResult::SAT:
+    return "sat";
+  case SmtResult::UNSAT:
+    return "unsat";
+  default:
+    return "unknown";
+  }
+}
+
+inline SmtResult ToSmtResult(const std::string& res) {
+  if (res == "sat") {
+    return SmtResult::SAT;
+  }
+  return (res == "unsat") ? SmtResult::UNSAT : SmtResult::UNKNOWN;
+}
+
+inline std::ostream& operator<<(std::ostream& out, const SmtResult& res) {
+  return out << ToString(res);
+}
+
+// solver statistics by name, e.g., conflicts, decisions, and memory
+typedef std::map<std::string, double> SolverStat;
+
+// statistics of the last check of an incremental solver, i.e., the counters
+// minus their earlier values (peak values, e.g., memory, as is)
+SolverStat DiffSolverStat(const SolverStat& before, const SolverStat& after);
+
+// independent assertion scope on the context/solver of the SMT generator
+// (a fresh z3 solver, or a push/pop frame of the shared smt-switch solver)
+template <class Generator> class Solver {
+public:
+  typedef decltype(
+      std::declval<SmtShim<Generator>&>().GetShimExpr(nullptr, "")) SmtExpr;
+
+  // constructor (with time limit in ms, 0 for none) and destructor
+  Solver(SmtShim<Generator>& smt_gen, const unsigned& timeout = 0);
+  ~Solver();
+
+  // add assertion
+  void Add(const SmtExpr& expr);
+  // check satisfiability of the assertions
+  SmtResult Check();
+  // nested assertion frame
+  void Push();
+  void Pop();
+
+  // value of the expression in the model of the last (sat) check
+  SmtExpr GetValue(const SmtExpr& expr);
+  // helper - string representation of the expression
+  static std::string ToString(const SmtExpr& expr);
+
+  // backend statistics accumulated over the checks so far
+  SolverStat GetStatistics();
+#ifdef USE_Z3
+  static SolverStat GetStatistics(z3::solver& solver);
+#endif
+
+#ifdef USE_Z3
+  inline z3::solver& get() { return solver_; }
+#else
+  inline smt::SmtSolver& get() { return solver_; }
+#endif
+
+private:
+#ifdef USE_Z3
+  z3::solver solver_;
+#else
+  smt::SmtSolver& solver_;
+#endif
+
+}; // class Solver
+
+} // namespace ilang
+
+#endif // PFFC_SOLVER_H__
@@ -0,0 +1,131 @@
+// =============================================================================
+// MIT License
+//
+// Copyright (c) 2020 Princeton University
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+
+// File: stat.h
+
+#ifndef PFFC_STAT_H__
+#define PFFC_STAT_H__
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace ilang {
+
+// record of applying one optimization pass on one model
+struct PassStat {
+  // pass name
+  std::string pass;
+  // model index (0/1)
+  int model;
+  // number of unique expression nodes before/after the pass
+  size_t node_before;
+  size_t node_after;
+  // wall time in seconds
+  double time;
+};
+
+// record of one solver query, e.g., an obligation or a segment
+struct QueryStat {
+  // query name
+  std::string name;
+  // result, i.e., sat, unsat, or unknown
+  std::string result;
+  // wall time in seconds
+  double time;
+  // number of unrolled steps of each instruction, as "m<idx>:<name>"
+  std::map<std::string, size_t> instr;
+  // backend statistics of the query (counters, memory, etc.)
+  std::map<std::string, double> solver;
+};
+
+// statistics of one check
+struct CheckStat {
+  // result of the (last) query, i.e., sat, unsat, or unknown
+  std::string result;
+  // total wall time in seconds
+  double time = 0;
+  // expression nodes of each model (after the passes)
+  std::vector<size_t> node;
+  // wall time of unrolling in seconds
+  double unroll_time = 0;
+  // bit-blasting time, external SAT solver time (in seconds), and whether the
+  // CNF is taken from the cache
+  double cnf_time = 0;
+  double sat_time = 0;
+  bool cnf_cache_hit = false;
+  // number of obligations, and the ones finished before (campaign)
+  size_t obligation_num = 0;
+  size_t obligation_skipped = 0;
+  // number of obligations whose verdict of the previous run is reused
+  size_t obligation_reused = 0;
+  // number of queries for the remaining obligations (one per group)
+  size_t obligation_group = 0;
+  // number of cubes (cube-and-conquer)
+  size_t cube_num = 0;
+  // peak resident set size of the process during the check in KB
+  size_t peak_mem = 0;
+  // optimization passes (in the order applied)
+  std::vector<PassStat> passes;
+  // solver queries (in the order solved)
+  std::vector<QueryStat> queries;
+};
+
+// JSON export
+void to_json(nlohmann::json& j, const PassStat& stat);
+void to_json(nlohmann::json& j, const QueryStat& stat);
+void to_json(nlohmann::json& j, const CheckStat& stat);
+
+// helper - peak resident set size of the process since the last reset in KB
+// (Linux, otherwise since the process start)
+size_t GetPeakMemory();
+void ResetPeakMemory();
+
+// helper - SHA-256 of the content in hex (stable across builds, for the keys
+// persisted in files)
+std::string GetContentHash(const std::string& content);
+
+// helper - wall clock timer
+class Timer {
+public:
+  Timer() : start_(std::chrono::steady_clock::now()) {}
+
+  // seconds elapsed since construction
+  inline double Elapsed() const {
+    std::chrono::duration<double> diff =
+        std::chrono::steady_clock::now() - start_;
+    return diff.count();
+  }
+
+private:
+  std::chrono::steady_clock::time_point start_;
+
+}; // class Timer
+
+} // namespace ilang
+
+#endif // PFFC_STAT_H__
@@ -0,0 +1,148 @@
+#!/usr/bin/env python3
+
+# ==============================================================================
+# MIT License
+#
+# Copyright (c) 2020 Princeton University
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+# ==============================================================================
+
+
+
+import argparse
+import json
+import os
+
+
+def ReadStat(file_name):
+    """ Return (job, stat) of a stat file, a server report, or a bare stat """
+
+    with open(file_name, 'r') as fr:
+        data = json.load(fr)
+
+    if 'stat' in data:
+        return data.get('job', file_name), data['stat']
+    else:
+        return os.path.splitext(os.path.basename(file_name))[0], data
+
+
+def GetCost(query, key):
+    """ Cost of a query, the wall time or a solver statistic """
+
+    if key == 'time':
+        return query.get('time', 0)
+    else:
+        return query.get('solver', {}).get(key, 0)
+
+
+def RankQueries(stats, key):
+    """ Return the queries (job, query) sorted by cost, most costly first """
+
+    queries = []
+    for job, stat in stats:
+        for q in stat.get('queries', []):
+            queries.append((job, q))
+
+    return sorted(queries, key=lambda jq: GetCost(jq[1], key), reverse=True)
+
+
+def RankInstructions(stats, key):
+    """ Return the instructions sorted by their share of the query cost """
+
+    # the cost of a query is split over its unrolled steps
+    cost = {}
+    steps = {}
+    for _, stat in stats:
+        for q in stat.get('queries', []):
+            instr = q.get('instr', {})
+            total = sum(instr.values())
+            if total == 0:
+                continue
+            for name, num in instr.items():
+                share = GetCost(q, key) * num / total
+                cost[name] = cost.get(name, 0) + share
+                steps[name] = steps.get(name, 0) + num
+
+    return sorted([(name, cost[name], steps[name]) for name in cost],
+                  key=lambda x: x[1], reverse=True)
+
+
+def SumSolverStat(stats):
+    """ Return the solver statistics summed over all queries """
+
+    total = {}
+    for _, stat in stats:
+        for q in stat.get('queries', []):
+            for name, value in q.get('solver', {}).items():
+                if 'memory' in name:
+                    total[name] = max(total.get(name, 0), value)
+                else:
+                    total[name] = total.get(name, 0) + value
+    return total
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(
+        description='Rank the queries and instructions by solver cost')
+
+    # required arguments
+    parser.add_argument('stat', type=str, nargs='+',
+                        help='stat files (stat_out of jobs, server reports)')
+
+    # optional arguments
+    parser.add_argument('-k', '--key', type=str, default='time',
+                        help='cost: time or a solver statistic, e.g., '
+                        'conflicts (default: time)')
+    parser.add_argument('-n', '--top', type=int, default=10,
+                        help='number of entries listed (default: 10)')
+    parser.add_argument('-o', '--out', type=str,
+                        help='write the rankings as JSON')
+
+    args = parser.parse_args()
+
+    stats = [ReadStat(f) for f in args.stat]
+    queries = RankQueries(stats, args.key)
+    instrs = RankInstructions(stats, args.key)
+    total = SumSolverStat(stats)
+
+    print('Queries by {}:'.format(args.key))
+    for job, q in queries[:args.top]:
+        print('  {:>12.3f}  {:<8} {}/{}'.format(
+            GetCost(q, args.key), q.get('result', ''), job, q.get('name', '')))
+
+    print('Instructions by {} (share of the queries unrolling them):'.format(
+        args.key))
+    for name, cost, num in instrs[:args.top]:
+        print('  {:>12.3f}  {:>8} steps  {}'.format(cost, num, name))
+
+    print('Solver statistics (sum over {} queries):'.format(len(queries)))
+    for name in sorted(total):
+        print('  {:<32} {}'.format(name, total[name]))
+
+    if args.out:
+        with open(args.out, 'w') as fw:
+            json.dump({'key': args.key,
+                       'queries': [{'job': job, 'name': q.get('name', ''),
+                                    'cost': GetCost(q, args.key)}
+                                   for job, q in queries],
+                       'instructions': [{'name': name, 'cost': cost,
+                                         'steps': num}
+                                        for name, cost, num in instrs],
+                       'solver': total}, fw, indent=2)
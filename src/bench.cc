@@ -0,0 +1,207 @@
+// =============================================================================
+// MIT License
+//
+// Copyright (c) 2020 Princeton University
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+
+// File: bench.cc
+
+#include <algorithm>
+#include <fstream>
+
+#include <fmt/format.h>
+#include <ilang/util/log.h>
+#include <nlohmann/json.hpp>
+
+#include <pffc/bench.h>
+
+using json = nlohmann::json;
+
+namespace ilang {
+
+std::map<std::string, double> GetBenchMetric(const CheckStat& stat) {
+  double pass_time = 0;
+  for (const auto& p : stat.passes) {
+    pass_time += p.time;
+  }
+
+  std::map<std::string, double> metric;
+  metric["time"] = stat.time;
+  metric["pass_time"] = pass_time;
+  metric["unroll_time"] = stat.unroll_time;
+  metric["cnf_time"] = stat.cnf_time;
+  metric["sat_time"] = stat.sat_time;
+  metric["solve_time"] = std::max(stat.time - pass_time - stat.unroll_time -
+                                      stat.cnf_time - stat.sat_time,
+                                  0.0);
+  for (auto i = 0; i < stat.node.size(); i++) {
+    metric[fmt::format("node_m{}", i)] = stat.node.at(i);
+  }
+  metric["peak_mem"] = stat.peak_mem;
+  return metric;
+}
+
+// helper - run the job in a child process
+static BenchRecord RunIsolated(const Job& job) {
+  auto _report = [](const bool& verified, const CheckStat& stat) {
+    return json{{"result", stat.result}, {"metric", GetBenchMetric(stat)}};
+  };
+  auto res = RunJobIsolated(job, _report);
+  if (res.is_null()) {
+    return {"error", {}};
+  }
+  return {res.at("result").get<std::string>(),
+          res.at("metric").get<std::map<std::string, double>>()};
+}
+
+// helper - revisions of the built-in models
+static json GetModelRevision() {
+  auto rev = json::object();
+#ifdef FLEX_REV
+  rev["flex"] = FLEX_REV;
+#endif
+#ifdef RELAY_REV
+  rev["relay"] = RELAY_REV;
+#endif
+  return rev;
+}
+
+bool IsRegressed(const std::string& name, const double& base,
+                 const double& curr, const BenchTolerance& tol) {
+  if (name.rfind("node_", 0) == 0) {
+    return curr > base * (1 + tol.node);
+  }
+  if (name == "peak_mem") {
+    return curr > base * tol.peak_mem;
+  }
+  return curr > base * tol.time && curr - base > tol.min_time;
+}
+
+int RunBench(const fs::path& corpus, const fs::path& baseline,
+             const bool& record) {
+  ILA_ASSERT(fs::is_regular_file(corpus)) << corpus;
+
+  std::ifstream corpus_in(corpus);
+  json corpus_reader;
+  corpus_in >> corpus_reader;
+  corpus_in.close();
+
+  json base = {{"tolerance", json::object()}, {"jobs", json::object()}};
+  if (fs::is_regular_file(baseline)) {
+    std::ifstream base_in(baseline);
+    base_in >> base;
+    base_in.close();
+  }
+
+  auto& tol_reader = base["tolerance"];
+  BenchTolerance tol;
+  tol.time = tol_reader.value("time", tol.time);
+  tol.min_time = tol_reader.value("min_time", tol.min_time);
+  tol.node = tol_reader.value("node", tol.node);
+  tol.peak_mem = tol_reader.value("peak_mem", tol.peak_mem);
+
+  // the verdicts and node counts depend on the models, so a baseline of
+  // other model revisions is not comparable (the diff is still shown)
+  auto num_regress = 0;
+  auto rev = GetModelRevision();
+  auto base_rev = base.value("revision", json::object());
+  if (!record && base_rev != rev) {
+    ILA_ERROR << fmt::format("Baseline models {} differ from the built {}, "
+                             "pin the revisions or record again",
+                             base_rev.dump(), rev.dump());
+    num_regress++;
+  }
+
+  json records = json::object();
+  for (const auto& job_file : corpus_reader.at("jobs")) {
+    auto job = ReadJob(corpus.parent_path() / job_file.get<std::string>());
+    auto curr = RunIsolated(job);
+    records[job.name] = {{"result", curr.result}, {"metric", curr.metric}};
+
+    // a crashed job is never a valid baseline
+    if (curr.result == "error") {
+      ILA_ERROR << "Job " << job.name << " REGRESSED (error)";
+      num_regress++;
+      continue;
+    }
+
+    if (record) {
+      continue;
+    }
+
+    if (!base["jobs"].contains(job.name)) {
+      ILA_ERROR << "Job " << job.name << " REGRESSED (no baseline)";
+      num_regress++;
+      continue;
+    }
+
+    // per-phase diff
+    auto& job_base = base["jobs"][job.name];
+    auto base_result = job_base.value("result", "");
+    auto regress = (curr.result != base_result);
+    ILA_INFO << fmt::format("{}: {} (baseline {}){}", job.name, curr.result,
+                            base_result, regress ? " REGRESSED" : "");
+
+    auto base_metric = job_base.value("metric", json::object());
+    if (base_metric.empty()) {
+      ILA_ERROR << "Job " << job.name << " REGRESSED (no baseline metric)";
+      regress = true;
+    }
+    for (auto it = base_metric.begin(); it != base_metric.end(); ++it) {
+      auto name = it.key();
+      auto pos = curr.metric.find(name);
+      if (pos == curr.metric.end()) {
+        continue;
+      }
+      auto prev = it.value().get<double>();
+      auto ratio = (prev > 0) ? pos->second / prev : 1.0;
+      auto fail = IsRegressed(name, prev, pos->second, tol);
+      regress |= fail;
+      ILA_INFO << fmt::format("  {:<12} {:>12.3f} -> {:>12.3f} ({:.2f}x){}",
+                              name, prev, pos->second, ratio,
+                              fail ? " REGRESSED" : "");
+    }
+    num_regress += regress;
+  }
+
+  if (record) {
+    if (num_regress > 0) {
+      ILA_ERROR << num_regress << " failed job(s), baseline not recorded";
+      return num_regress;
+    }
+    base["revision"] = rev;
+    base["jobs"] = records;
+    base["tolerance"] = {{"time", tol.time},
+                         {"min_time", tol.min_time},
+                         {"node", tol.node},
+                         {"peak_mem", tol.peak_mem}};
+    std::ofstream fout(baseline);
+    fout << base.dump(2) << std::endl;
+    fout.close();
+    ILA_INFO << "Baseline recorded to " << baseline;
+    return 0;
+  }
+
+  ILA_INFO << num_regress << " regressed job(s)";
+  return num_regress;
+}
+
+} // namespace ilang
@@ -0,0 +1,66 @@
+// =============================================================================
+// MIT License
+//
+// Copyright (c) 2020 Princeton University
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+
+// File: cmd_expr.cc
+
+#include <ilang/util/log.h>
+
+#include <pffc/cmd_expr.h>
+
+namespace ilang {
+
+ExprRef CmdExprBuilder::Input(const std::string& name) {
+  auto pos = inputs_.find(name);
+  if (pos == inputs_.end()) {
+    pos = inputs_.emplace(name, m_.input(name)).first;
+  }
+  return pos->second;
+}
+
+ExprRef CmdExprBuilder::Field(const std::string& name,
+                              const unsigned long long& value) {
+  auto key = std::make_pair(name, value);
+  auto pos = fields_.find(key);
+  if (pos == fields_.end()) {
+    pos = fields_.emplace(key, Input(name) == value).first;
+  }
+  return pos->second;
+}
+
+ExprRef CmdExprBuilder::Command(const FieldVec& fields) {
+  ILA_ASSERT(!fields.empty());
+  num_cmd_++;
+
+  auto pos = cmds_.find(fields);
+  if (pos == cmds_.end()) {
+    auto cmd_expr = Field(fields.front().first, fields.front().second);
+    for (auto i = 1; i < fields.size(); i++) {
+      cmd_expr = cmd_expr & Field(fields.at(i).first, fields.at(i).second);
+    }
+    pos = cmds_.emplace(fields, cmd_expr).first;
+  }
+  return pos->second;
+}
+
+} // namespace ilang
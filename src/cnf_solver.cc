@@ -0,0 +1,534 @@
+// =============================================================================
+// MIT License
+//
+// Copyright (c) 2020 Princeton University
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+
+// File: cnf_solver.cc
+
+#ifdef USE_Z3
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <set>
+#include <sstream>
+#include <thread>
+
+#include <fmt/format.h>
+#include <ilang/util/log.h>
+
+#include <pffc/cnf_solver.h>
+#include <pffc/stat.h>
+
+namespace ilang {
+
+CnfSolver::CnfSolver(z3::context& ctx, const std::string& cmd,
+                     const fs::path& cache_dir, const unsigned& timeout)
+    : ctx_(ctx), cmd_(cmd), cache_dir_(cache_dir), timeout_(timeout) {
+  if (!cache_dir_.empty()) {
+    fs::create_directories(cache_dir_);
+  }
+}
+
+SmtResult CnfSolver::Check() {
+  cache_hit_ = false;
+  cnf_time_ = 0;
+  sat_time_ = 0;
+
+  // private to the process and thread (the server runs several checks at
+  // once, and other processes may share the cache)
+  auto tid = std::hash<std::thread::id>{}(std::this_thread::get_id());
+  auto owner = fmt::format("{}_{:x}", getpid(), tid);
+
+  // reuse the CNF of an identical query
+  auto key = GetQueryKey();
+  auto file = cache_dir_ / (key + ".cnf");
+  if (cache_dir_.empty()) {
+    file = fs::temp_directory_path() /
+           fmt::format("pffc_{}_{}.cnf", owner, key);
+  }
+  if (!cache_dir_.empty() && fs::is_regular_file(file)) {
+    cache_hit_ = true;
+    ILA_INFO << "Reuse CNF " << file;
+  } else {
+    // renamed in place when complete, so a cached file is never partial
+    auto tmp = file;
+    tmp += fmt::format(".{}.tmp", owner);
+    Timer timer;
+    auto status = ToCnf(tmp);
+    cnf_time_ = timer.Elapsed();
+    if (!status) {
+      fs::remove(tmp);
+      return SmtResult::UNKNOWN;
+    }
+    fs::rename(tmp, file);
+  }
+
+  Timer timer;
+  auto res = RunSat(file);
+  sat_time_ = timer.Elapsed();
+
+  if (cache_dir_.empty()) {
+    fs::remove(file);
+  }
+  return res;
+}
+
+std::string CnfSolver::GetQueryKey() const {
+  std::stringstream query;
+  for (const auto& e : query_) {
+    query << e << "\n";
+  }
+  return GetContentHash(query.str());
+}
+
+bool CnfSolver::ToCnf(const fs::path& file) const {
+  auto _t = [this](const char* name) { return z3::tactic(ctx_, name); };
+  auto _limit = [this](const z3::tactic& t) {
+    return timeout_ ? z3::try_for(t, timeout_) : t;
+  };
+
+  std::string dimacs;
+  try {
+    // word-level simplification, where solve-eqs also eliminates the memory
+    // states defined by the transitions
+    z3::goal goal(ctx_);
+    for (const auto& e : query_) {
+      goal.add(e);
+    }
+    auto pre = _limit(_t("simplify") & _t("propagate-values") &
+                      _t("solve-eqs"))(goal);
+    if (pre.size() != 1) {
+      ILA_WARN << "Simplification splits the query into " << pre.size()
+               << " goals";
+      return false;
+    }
+
+    std::vector<z3::expr> query;
+    for (auto i = 0; i < pre[0].size(); i++) {
+      query.push_back(pre[0][i]);
+    }
+    Abstract(query);
+
+    // bit-blasting into an AIG (structural hashing and rewriting merge
+    // equivalent nodes) and Tseitin encoding
+    z3::goal abs_goal(ctx_);
+    for (const auto& e : query) {
+      abs_goal.add(e);
+    }
+    auto pipeline = _t("simplify") & _t("propagate-values") &
+                    _t("solve-eqs") & _t("elim-uncnstr") &
+                    _t("ackermannize_bv") & _t("simplify") & _t("bit-blast") &
+                    _t("aig") & _t("tseitin-cnf");
+    auto res = _limit(pipeline)(abs_goal);
+    if (res.size() != 1) {
+      ILA_WARN << "Bit-blasting splits the query into " << res.size()
+               << " goals";
+      return false;
+    }
+
+    auto cnf = res[0];
+    if (cnf.is_decided_unsat()) {
+      dimacs = "p cnf 0 1\n0\n";
+    } else if (cnf.is_decided_sat()) {
+      dimacs = "p cnf 0 0\n";
+    } else {
+      dimacs = cnf.dimacs(false);
+    }
+  } catch (z3::exception& e) {
+    // e.g., arrays or quantifiers left after the abstraction, or timeout
+    ILA_WARN << "Query is not bit-blastable: " << e.msg();
+    return false;
+  }
+
+  std::ofstream fout(file);
+  fout << dimacs;
+  fout.close();
+  if (!fout) {
+    ILA_ERROR << "Fail writing CNF " << file;
+    return false;
+  }
+  ILA_INFO << "CNF written to " << file;
+  return true;
+}
+
+void CnfSolver::Abstract(std::vector<z3::expr>& query) const {
+  // top-level conjuncts, split into axioms, memory relations, and the rest
+  std::vector<z3::expr> axioms;
+  std::vector<z3::expr> mem_eqs;
+  std::vector<z3::expr> ground;
+  std::vector<z3::expr> todo(query.rbegin(), query.rend());
+  while (!todo.empty()) {
+    auto e = todo.back();
+    todo.pop_back();
+    if (e.is_and()) {
+      for (auto i = e.num_args(); i > 0; i--) {
+        todo.push_back(e.arg(i - 1));
+      }
+    } else if (e.is_quantifier() && e.is_forall()) {
+      axioms.push_back(e);
+    } else if (e.is_eq() && e.arg(0).is_array()) {
+      mem_eqs.push_back(e);
+    } else {
+      ground.push_back(e);
+    }
+  }
+
+  // applications of the uninterpreted functions (by declaration)
+  auto _is_uf = [](const z3::expr& e) {
+    return e.is_app() && e.num_args() > 0 &&
+           e.decl().decl_kind() == Z3_OP_UNINTERPRETED;
+  };
+  auto _collect_app = [&_is_uf](const std::vector<z3::expr>& roots) {
+    std::map<unsigned, std::vector<z3::expr>> apps;
+    std::set<unsigned> visited;
+    std::vector<z3::expr> todo(roots.begin(), roots.end());
+    while (!todo.empty()) {
+      auto e = todo.back();
+      todo.pop_back();
+      if (!visited.insert(e.id()).second) {
+        continue;
+      }
+      if (e.is_quantifier()) {
+        todo.push_back(e.body());
+      } else if (e.is_app()) {
+        if (_is_uf(e)) {
+          apps[e.decl().id()].push_back(e);
+        }
+        for (auto i = 0; i < e.num_args(); i++) {
+          todo.push_back(e.arg(i));
+        }
+      }
+    }
+    return apps;
+  };
+
+  // axioms - instances at the ground applications matching the applications
+  // of the axiom on its bound variables (the others are dropped)
+  auto ground_apps = _collect_app(ground);
+  std::set<unsigned> inst_ids;
+  for (const auto& q : axioms) {
+    auto num_bound = Z3_get_quantifier_num_bound(ctx_, q);
+    auto body = q.body();
+    for (const auto& [decl, patterns] : _collect_app({body})) {
+      auto it = ground_apps.find(decl);
+      if (it == ground_apps.end()) {
+        continue;
+      }
+      for (const auto& p : patterns) {
+        for (const auto& app : it->second) {
+          // bound variable (de Bruijn index) -> argument of the application
+          std::map<unsigned, z3::expr> binding;
+          auto match = true;
+          for (auto i = 0; i < p.num_args() && match; i++) {
+            if (!p.arg(i).is_var()) {
+              match = false;
+              break;
+            }
+            auto idx = Z3_get_index_value(ctx_, p.arg(i));
+            auto [pos, is_new] = binding.emplace(idx, app.arg(i));
+            match = is_new || z3::eq(pos->second, app.arg(i));
+          }
+          if (!match || binding.size() != num_bound) {
+            continue;
+          }
+          z3::expr_vector dst(ctx_);
+          for (auto i = 0; i < num_bound; i++) {
+            dst.push_back(binding.at(i));
+          }
+          auto inst = body.substitute(dst);
+          if (inst_ids.insert(inst.id()).second) {
+            ground.push_back(inst);
+          }
+        }
+      }
+    }
+  }
+  ILA_INFO << fmt::format("Instantiated {} axioms {} times", axioms.size(),
+                          inst_ids.size());
+
+  // memory reads - pushed through stores and ite down to the memory
+  // constants, which are read at the recorded addresses
+  std::map<unsigned, z3::expr> rw_cache;
+  std::map<std::pair<unsigned, unsigned>, z3::expr> read_cache;
+  std::map<unsigned, std::vector<z3::expr>> addr;
+  std::map<unsigned, z3::expr> mem;
+  std::function<z3::expr(const z3::expr&)> _rewrite;
+  std::function<z3::expr(const z3::expr&, const z3::expr&)> _read;
+
+  _read = [this, &_rewrite, &_read, &read_cache, &addr,
+           &mem](const z3::expr& m, const z3::expr& a) {
+    auto key = std::make_pair(m.id(), a.id());
+    auto pos = read_cache.find(key);
+    if (pos != read_cache.end()) {
+      return pos->second;
+    }
+
+    auto res = z3::expr(ctx_);
+    auto kind = m.is_app() ? m.decl().decl_kind() : Z3_OP_UNINTERPRETED;
+    if (kind == Z3_OP_STORE) {
+      auto store_a = _rewrite(m.arg(1));
+      auto data = _rewrite(m.arg(2));
+      if (z3::eq(store_a, a)) {
+        res = data;
+      } else if (store_a.is_numeral() && a.is_numeral()) {
+        res = _read(m.arg(0), a);
+      } else {
+        res = z3::ite(store_a == a, data, _read(m.arg(0), a));
+      }
+    } else if (kind == Z3_OP_ITE) {
+      res = z3::ite(_rewrite(m.arg(0)), _read(m.arg(1), a),
+                    _read(m.arg(2), a));
+    } else if (kind == Z3_OP_CONST_ARRAY) {
+      res = _rewrite(m.arg(0));
+    } else {
+      // memory constant (anything else is left to fail bit-blasting)
+      res = z3::select(m, a);
+      if (m.is_const()) {
+        addr[m.id()].push_back(a);
+        mem.emplace(m.id(), m);
+      }
+    }
+    read_cache.emplace(key, res);
+    return res;
+  };
+
+  _rewrite = [&_rewrite, &_read, &rw_cache](const z3::expr& e) {
+    auto pos = rw_cache.find(e.id());
+    if (pos != rw_cache.end()) {
+      return pos->second;
+    }
+
+    auto res = e;
+    if (e.is_app() && e.decl().decl_kind() == Z3_OP_SELECT &&
+        e.num_args() == 2) {
+      res = _read(e.arg(0), _rewrite(e.arg(1)));
+    } else if (e.is_app() && e.num_args() > 0) {
+      z3::expr_vector args(e.ctx());
+      auto changed = false;
+      for (auto i = 0; i < e.num_args(); i++) {
+        args.push_back(_rewrite(e.arg(i)));
+        changed |= !z3::eq(args[i], e.arg(i));
+      }
+      if (changed) {
+        res = e.decl()(args);
+      }
+    }
+    rw_cache.emplace(e.id(), res);
+    return res;
+  };
+
+  query.clear();
+  for (const auto& e : ground) {
+    query.push_back(_rewrite(e));
+  }
+
+  // memory relations - compared at the addresses read from the memory
+  // constants they are built on, until no new address is read
+  auto _base = [](z3::expr m) {
+    std::set<unsigned> bases;
+    std::vector<z3::expr> todo = {m};
+    while (!todo.empty()) {
+      auto e = todo.back();
+      todo.pop_back();
+      auto kind = e.is_app() ? e.decl().decl_kind() : Z3_OP_UNINTERPRETED;
+      if (kind == Z3_OP_STORE) {
+        todo.push_back(e.arg(0));
+      } else if (kind == Z3_OP_ITE) {
+        todo.push_back(e.arg(1));
+        todo.push_back(e.arg(2));
+      } else if (e.is_const()) {
+        bases.insert(e.id());
+      }
+    }
+    return bases;
+  };
+
+  std::vector<std::set<unsigned>> related(mem_eqs.size());
+  for (auto changed = true; changed;) {
+    changed = false;
+    for (auto i = 0; i < mem_eqs.size(); i++) {
+      const auto& eq = mem_eqs.at(i);
+      auto bases = _base(eq.arg(0));
+      bases.merge(_base(eq.arg(1)));
+      for (const auto& b : bases) {
+        // copied, since the reads below extend the address lists
+        auto addr_b = addr[b];
+        for (const auto& a : addr_b) {
+          if (related.at(i).insert(a.id()).second) {
+            query.push_back(_read(eq.arg(0), a) == _read(eq.arg(1), a));
+            changed = true;
+          }
+        }
+      }
+    }
+  }
+
+  // Ackermann reduction of the reads from the memory constants
+  z3::expr_vector src(ctx_);
+  z3::expr_vector dst(ctx_);
+  for (const auto& [id, addr_m] : addr) {
+    auto& m = mem.at(id);
+    std::vector<z3::expr> data;
+    for (const auto& a : addr_m) {
+      auto name = fmt::format("{}_read_{}", m.decl().name().str(), data.size());
+      data.push_back(ctx_.constant(name.c_str(), m.get_sort().array_range()));
+      src.push_back(z3::select(m, a));
+      dst.push_back(data.back());
+    }
+
+    // same address, same data (distinct constant addresses never meet)
+    for (auto i = 0; i < addr_m.size(); i++) {
+      for (auto j = i + 1; j < addr_m.size(); j++) {
+        auto& a_i = addr_m.at(i);
+        auto& a_j = addr_m.at(j);
+        if (!a_i.is_numeral() || !a_j.is_numeral()) {
+          query.push_back(z3::implies(a_i == a_j, data.at(i) == data.at(j)));
+        }
+      }
+    }
+  }
+  for (auto& e : query) {
+    e = e.substitute(src, dst);
+  }
+
+  ILA_INFO << fmt::format("Related {} memories at {} addresses",
+                          mem_eqs.size(), src.size());
+}
+
+SmtResult CnfSolver::RunSat(const fs::path& file) const {
+  // split on white space (no shell), the CNF file as the last argument
+  std::vector<std::string> args;
+  std::istringstream cmd_in(cmd_);
+  for (std::string arg; cmd_in >> arg;) {
+    args.push_back(arg);
+  }
+  if (args.empty()) {
+    ILA_ERROR << "Empty SAT solver command";
+    return SmtResult::UNKNOWN;
+  }
+  args.push_back(file.string());
+
+  auto cmd = args.front();
+  for (auto i = 1; i < args.size(); i++) {
+    cmd += " " + args.at(i);
+  }
+  ILA_INFO << "Run " << cmd;
+
+  // prepared before forking, the child only calls exec
+  std::vector<char*> argv;
+  for (auto& arg : args) {
+    argv.push_back(arg.data());
+  }
+  argv.push_back(nullptr);
+
+  int fd[2];
+  if (pipe(fd) != 0) {
+    ILA_ERROR << "Fail running " << cmd;
+    return SmtResult::UNKNOWN;
+  }
+  auto pid = fork();
+  if (pid == 0) {
+    // own process group, so that a wrapper script is killed with its solver
+    setpgid(0, 0);
+    dup2(fd[1], STDOUT_FILENO);
+    close(fd[0]);
+    close(fd[1]);
+    execvp(argv.front(), argv.data());
+    _exit(127);
+  }
+  close(fd[1]);
+  if (pid < 0) {
+    close(fd[0]);
+    ILA_ERROR << "Fail running " << cmd;
+    return SmtResult::UNKNOWN;
+  }
+  setpgid(pid, pid);
+
+  // collect the output until the solver exits or runs out of time
+  auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_);
+  auto timed_out = false;
+  std::string out;
+  char buff[256];
+  while (true) {
+    auto wait = -1;
+    if (timeout_) {
+      auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                      deadline - std::chrono::steady_clock::now())
+                      .count();
+      if (left <= 0) {
+        timed_out = true;
+        kill(-pid, SIGKILL);
+        break;
+      }
+      wait = static_cast<int>(left);
+    }
+    pollfd pfd = {fd[0], POLLIN, 0};
+    auto ready = poll(&pfd, 1, wait);
+    if (ready < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ready < 0) {
+      break;
+    }
+    if (ready > 0) {
+      auto n = read(fd[0], buff, sizeof(buff));
+      if (n <= 0) {
+        break;
+      }
+      out.append(buff, n);
+    }
+  }
+  close(fd[0]);
+  int status = 0;
+  waitpid(pid, &status, 0);
+
+  if (timed_out) {
+    ILA_WARN << "SAT solver timeout after " << timeout_ << " ms";
+    return SmtResult::UNKNOWN;
+  }
+
+  // status line of the SAT competition output format
+  auto res = SmtResult::UNKNOWN;
+  std::istringstream out_in(out);
+  for (std::string line; std::getline(out_in, line);) {
+    if (line.rfind("s SATISFIABLE", 0) == 0) {
+      res = SmtResult::SAT;
+    } else if (line.rfind("s UNSATISFIABLE", 0) == 0) {
+      res = SmtResult::UNSAT;
+    }
+  }
+  ILA_WARN_IF(res == SmtResult::UNKNOWN) << "No status line from " << cmd;
+  return res;
+}
+
+} // namespace ilang
+
+#endif // USE_Z3
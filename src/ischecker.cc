@@ -25,13 +25,24 @@
 // File: ischecker.cc
 
 #include <fstream>
+#include <map>
+#include <memory>
+#include <unordered_set>
 
+#include <fmt/format.h>
 #include <ilang/ila/instr_lvl_abs.h>
 #include <ilang/target-smt/smt_switch_itf.h>
 #include <ilang/target-smt/z3_expr_adapter.h>
 #include <ilang/util/log.h>
 #include <nlohmann/json.hpp>
 
+#ifdef USE_Z3
+#include <z3++.h>
+#else
+#include <smt-switch/smt.h>
+#endif
+
+#include <pffc/cnf_solver.h>
 #include <pffc/ischecker.h>
 
 using json = nlohmann::json;
@@ -45,118 +56,315 @@ template class IsChecker<SmtSwitchItf>;
 #endif
 
 template <class Generator>
-IsChecker<Generator>::IsChecker(const Ila& m0, const Ila& m1,
+IsChecker<Generator>::IsChecker(const std::vector<Ila>& models,
                                 SmtShim<Generator>& smt_gen)
-    : m0_(m0), m1_(m1), smt_gen_(smt_gen) {
-  unroller_m0_ = new PathUnroller<Generator>(smt_gen_);
-  unroller_m1_ = new PathUnroller<Generator>(smt_gen_);
+    : m_(models), smt_gen_(smt_gen) {
+  ILA_ASSERT(m_.size() >= 2) << "Need at least two models";
+  instr_seq_.resize(m_.size());
+  env_.resize(m_.size());
+  for (auto i = 0; i < m_.size(); i++) {
+    unroller_.push_back(std::make_unique<PathUnroller<Generator>>(smt_gen_));
+  }
   Preprocess();
 }
 
-template <class Generator> IsChecker<Generator>::~IsChecker() {
-  if (unroller_m0_) {
-    delete unroller_m0_;
-    unroller_m0_ = nullptr;
-  }
-
-  if (unroller_m1_) {
-    delete unroller_m1_;
-    unroller_m1_ = nullptr;
+template <class Generator>
+IsChecker<Generator>::IsChecker(const std::vector<FlatIla>& models,
+                                SmtShim<Generator>& smt_gen)
+    : smt_gen_(smt_gen) {
+  ILA_ASSERT(models.size() >= 2) << "Need at least two models";
+  for (const auto& m : models) {
+    m_.push_back(m.model);
+    top_instr_.push_back(m.top_instr);
+    unroller_.push_back(std::make_unique<PathUnroller<Generator>>(smt_gen_));
   }
+  instr_seq_.resize(m_.size());
+  env_.resize(m_.size());
 }
 
 template <class Generator> bool IsChecker<Generator>::Check() {
-  // make sure the sequence has been specified
-  if (instr_seq_m0_.empty() or instr_seq_m1_.empty()) {
-    ILA_ERROR << "Instruction sequence not set";
-    return false;
+  // make sure the sequences have been specified
+  for (const auto& seq : instr_seq_) {
+    if (seq.empty()) {
+      ILA_ERROR << "Instruction sequence not set";
+      return false;
+    }
   }
 
-  // optimize
-#if 0
-  std::vector<Ila::PassID> pass = {Ila::PassID::SIMPLIFY_SYNTACTIC,
-                                   Ila::PassID::REWRITE_CONDITIONAL_STORE};
-  m0_.ExecutePass(pass);
-  m1_.ExecutePass(pass);
-#endif
+  stat_ = CheckStat();
+  Timer timer;
+  ResetPeakMemory();
 
-  // unroll the program and get the smt expression
-  ILA_NOT_NULL(unroller_m0_);
-  ILA_NOT_NULL(unroller_m1_);
+  // optimize
+  for (auto i = 0; i < m_.size(); i++) {
+    ApplyPasses(m_.at(i), i, passes_, stat_.passes);
+    stat_.node.push_back(GetExprNodeNum(m_.at(i)));
+  }
 
   // add design specific constraints
-  AddEnvM0();
-  AddEnvM1();
-
-  // unroll two instruction sequences
-  InstrVec instr_seq_m0;
-  InstrVec instr_seq_m1;
-  for (const auto& i : instr_seq_m0_) {
-    instr_seq_m0.push_back(i.get());
+  for (auto i = 0; i < m_.size(); i++) {
+    env_.at(i).clear();
+    AddEnv(i);
   }
-  for (const auto& i : instr_seq_m1_) {
-    instr_seq_m1.push_back(i.get());
+
+  auto res = SmtResult::UNKNOWN;
+  auto loop = induction_ ? GetLoop() : Loop{{}, {}, 0};
+  auto segments = compositional_ ? GetSegments() : std::vector<Segment>();
+  ILA_WARN_IF(induction_ && loop.num_iter <= induction_)
+      << "No loop with more than " << induction_ << " iterations";
+  // the start states of the inductive step and the segments are only
+  // constrained by the relation, so only unsat is conclusive
+  auto _confirm = [this](const SmtResult& res, const std::string& mode) {
+    if (res == SmtResult::UNSAT) {
+      return res;
+    }
+    ILA_WARN << mode << " check inconclusive (" << res
+             << "), fall back to monolithic checking";
+    return CheckMonolithic();
+  };
+
+  if (journal_ || merge_obligation_ || !incremental_.empty()) {
+    // obligations one by one (recorded in the journal if any)
+    ILA_WARN_IF(induction_ || compositional_)
+        << "Obligations are checked on the whole sequences";
+    res = CheckObligations();
+  } else if (induction_ && loop.num_iter > induction_) {
+    // inductive - cost independent of the number of iterations
+    res = _confirm(CheckInductive(loop), "Inductive");
+  } else if (compositional_ && IsValidSegmentation(segments)) {
+    // compositional - check segment by segment
+    res = _confirm(CheckCompositional(segments), "Segment");
+  } else {
+    ILA_WARN_IF(compositional_)
+        << "Invalid segmentation, fall back to monolithic checking";
+    res = CheckMonolithic();
   }
-  auto is0 = unroller_m0_->Unroll(instr_seq_m0);
-  auto is1 = unroller_m1_->Unroll(instr_seq_m1);
 
-  // miter
-  auto miter = GetMiter();
+  stat_.result = ToString(res);
+  stat_.time = timer.Elapsed();
+  stat_.peak_mem = GetPeakMemory();
+  ILA_INFO << "Result: " << res << " (" << stat_.time << " s)";
+  return res == SmtResult::UNSAT;
+}
+
+template <class Generator> SmtResult IsChecker<Generator>::CheckMonolithic() {
+  // unroll the instruction sequences (once per model)
+  auto query = UnrollSegment(GetWholeSegment());
+
+  // miter (any pair)
+  query.push_back(GetMiter());
 
   // func
-  auto uninterp_func = GetUninterpFunc();
+  query.push_back(GetUninterpFunc());
+
+#ifdef USE_Z3
+  // proof on the bit-blasted query (the counterexample comes from z3)
+  if (!sat_cmd_.empty()) {
+    CnfSolver cnf_solver(smt_gen_.get().context(), sat_cmd_, cnf_cache_,
+                         timeout_);
+    for (const auto& e : query) {
+      cnf_solver.Add(e);
+    }
+    auto res = cnf_solver.Check();
+    stat_.cnf_cache_hit = cnf_solver.cache_hit();
+    stat_.cnf_time = cnf_solver.cnf_time();
+    stat_.sat_time = cnf_solver.sat_time();
+    RecordQuery("bit-blast", GetWholeSegment(), res,
+                stat_.cnf_time + stat_.sat_time,
+                {{"cnf_time", stat_.cnf_time},
+                 {"sat_time", stat_.sat_time},
+                 {"cnf_cache_hit", stat_.cnf_cache_hit}});
+    ILA_INFO << "SAT solver result: " << res;
+    if (res == SmtResult::UNSAT) {
+      return res;
+    }
+  }
+
+  // split into cubes (the sat cube is solved again for the counterexample)
+  if (cube_bits_ > 0) {
+    auto vars = GetSplitVar();
+    if (!vars.empty()) {
+      return CheckCube(query, vars);
+    }
+    ILA_WARN << "No split variable, skip cube-and-conquer";
+  }
+#endif
 
   // start solving
   ILA_INFO << "Start solving";
 
+  Solver<Generator> solver(smt_gen_, timeout_);
+  for (const auto& e : query) {
+    solver.Add(e);
+  }
+
+  Timer timer;
+  auto res = solver.Check();
+  RecordQuery("monolithic", GetWholeSegment(), res, timer.Elapsed(),
+              solver.GetStatistics());
 #ifdef USE_Z3
-  auto& ctx = smt_gen_.get().context();
-  z3::solver solver(ctx);
-  solver.add(is0);
-  solver.add(is1);
-  solver.add(miter);
-  solver.add(uninterp_func);
-
-  auto res = solver.check();
-  if (res == z3::sat) {
-    auto model = solver.get_model();
+  if (res == SmtResult::SAT) {
+    auto model = solver.get().get_model();
     Debug(model);
   }
-  ILA_INFO << "Result: " << res;
-  return res == z3::unsat;
+#endif
+  return res;
+}
 
-#else // not USE_Z3
-  auto& solver = smt_gen_.get().solver();
-  solver->assert_formula(is0);
-  solver->assert_formula(is1);
-  solver->assert_formula(miter);
-  solver->assert_formula(uninterp_func);
+template <class Generator>
+void IsChecker<Generator>::SetInstrSeq(const int& idx, const fs::path& file) {
+  ILA_ASSERT(fs::is_regular_file(file)) << file;
+  ILA_ASSERT(idx >= 0 && idx < m_.size()) << "No model " << idx;
+  ReadInstrSeq(m_.at(idx), file, instr_seq_.at(idx));
+}
+
+template <class Generator>
+void IsChecker<Generator>::SetPasses(const std::vector<std::string>& passes) {
+  ILA_WARN_IF(!passes_.empty()) << "Overwriting optimization passes";
+  passes_ = passes;
+}
+
+template <class Generator> void IsChecker<Generator>::Preprocess() {
+  top_instr_.clear();
+  for (auto& m : m_) {
+    auto flat = FlattenIla(m);
+    m = flat.model;
+    top_instr_.push_back(flat.top_instr);
+  }
+}
+
+template <class Generator>
+typename IsChecker<Generator>::SmtExpr IsChecker<Generator>::GetMiter() {
+  auto pairs = GetMiterPairs();
+  ILA_ASSERT(!pairs.empty()) << "No pair of models to compare";
+  auto miter = GetPairMiter(pairs.front().first, pairs.front().second);
+  for (auto i = 1; i < pairs.size(); i++) {
+    miter = BoolOr(miter, GetPairMiter(pairs.at(i).first, pairs.at(i).second));
+  }
+  return miter;
+}
 
-  auto res = solver->check_sat();
-  ILA_INFO << "Result: " << res;
-  return res.is_unsat();
+template <class Generator>
+std::vector<std::pair<size_t, size_t>> IsChecker<Generator>::GetMiterPairs() {
+  std::vector<std::pair<size_t, size_t>> pairs;
+  for (size_t i = 0; i + 1 < m_.size(); i++) {
+    pairs.push_back({i, i + 1});
+  }
+  return pairs;
+}
+
+template <class Generator>
+typename IsChecker<Generator>::Segment
+IsChecker<Generator>::GetWholeSegment() const {
+  Segment whole;
+  for (const auto& seq : instr_seq_) {
+    whole.begin.push_back(0);
+    whole.end.push_back(seq.size());
+  }
+  return whole;
+}
+
+template <class Generator>
+void IsChecker<Generator>::RecordQuery(const std::string& name,
+                                       const Segment& seg, const SmtResult& res,
+                                       const double& time,
+                                       const SolverStat& solver_stat) {
+  QueryStat query = {name, ToString(res), time, {}, solver_stat};
+  for (auto i = 0; i < m_.size(); i++) {
+    for (auto j = seg.begin.at(i); j < seg.end.at(i); j++) {
+      auto key = fmt::format("m{}:{}", i, instr_seq_.at(i).at(j).name());
+      query.instr[key]++;
+    }
+  }
+  stat_.queries.push_back(query);
+}
 
+template <class Generator>
+void IsChecker<Generator>::AssertEnv(PathUnroller<Generator>& unroller,
+                                     const EnvType& env, const size_t& begin,
+                                     const size_t& end) {
+  for (const auto& [expr, step] : env) {
+    if (step >= begin && step < end) {
+      unroller.AssertStep(expr.get(), step);
+    }
+  }
+}
+
+template <class Generator>
+InstrVec IsChecker<Generator>::GetInstrVec(const std::vector<InstrRef>& seq,
+                                           const size_t& begin,
+                                           const size_t& end) {
+  InstrVec res;
+  for (auto i = begin; i < end; i++) {
+    res.push_back(seq.at(i).get());
+  }
+  return res;
+}
+
+template <class Generator>
+typename IsChecker<Generator>::SmtExpr
+IsChecker<Generator>::BoolNot(const SmtExpr& a) {
+#ifdef USE_Z3
+  return !a;
+#else
+  auto& solver = smt_gen_.get().solver();
+  return solver->make_term(smt::PrimOp::Not, a);
 #endif
 }
 
 template <class Generator>
-void IsChecker<Generator>::SetInstrSeq(const int& idx, const fs::path& file) {
-  ILA_ASSERT(fs::is_regular_file(file)) << file;
-  if (idx == 0) {
-    ReadInstrSeq(m0_, file, instr_seq_m0_);
-  } else {
-    ReadInstrSeq(m1_, file, instr_seq_m1_);
+typename IsChecker<Generator>::SmtExpr
+IsChecker<Generator>::BoolOr(const SmtExpr& a, const SmtExpr& b) {
+#ifdef USE_Z3
+  return a || b;
+#else
+  auto& solver = smt_gen_.get().solver();
+  return solver->make_term(smt::PrimOp::Or, a, b);
+#endif
+}
+
+static const std::map<std::string, Ila::PassID> k_pass_id = {
+    {"SIMPLIFY_SYNTACTIC", Ila::PassID::SIMPLIFY_SYNTACTIC},
+    {"SIMPLIFY_SEMANTIC", Ila::PassID::SIMPLIFY_SEMANTIC},
+    {"REWRITE_CONDITIONAL_STORE", Ila::PassID::REWRITE_CONDITIONAL_STORE},
+    {"REWRITE_LOAD_FROM_STORE", Ila::PassID::REWRITE_LOAD_FROM_STORE} //
+};
+
+void ApplyPasses(Ila& m, const int& idx, const std::vector<std::string>& passes,
+                 std::vector<PassStat>& stat) {
+  for (const auto& name : passes) {
+    auto pos = k_pass_id.find(name);
+    if (pos == k_pass_id.end()) {
+      ILA_ERROR << "Unknown pass " << name;
+      continue;
+    }
+
+    auto node_before = GetExprNodeNum(m);
+
+    Timer timer;
+    auto status = m.ExecutePass({pos->second});
+    auto time = timer.Elapsed();
+    ILA_WARN_IF(!status) << "Fail executing " << name << " on m" << idx;
+
+    auto node_after = GetExprNodeNum(m);
+    stat.push_back({name, idx, node_before, node_after, time});
+    ILA_INFO << name << " on m" << idx << ": " << node_before << " -> "
+             << node_after << " nodes (" << time << " s)";
   }
 }
 
-template <class Generator> void IsChecker<Generator>::Preprocess() {
+FlatIla FlattenIla(const Ila& m) {
   // bookkeeping top-level instructions
-  GetTopInstr(m0_, top_instr_m0_);
-  GetTopInstr(m1_, top_instr_m1_);
+  std::set<std::string> top_instr;
+  for (auto i = 0; i < m.instr_num(); i++) {
+    top_instr.emplace(m.instr(i).name());
+  }
 
   // flatten hierarchy
-  m0_.FlattenHierarchy();
-  m1_.FlattenHierarchy();
+  auto flat = m;
+  flat.FlattenHierarchy();
+
+  return {flat, top_instr};
 }
 
 template <class Generator>
@@ -181,13 +389,32 @@ void IsChecker<Generator>::ReadInstrSeq(const Ila& m, const fs::path& file,
   }
 }
 
-template <class Generator>
-void IsChecker<Generator>::GetTopInstr(const Ila& m,
-                                       std::set<std::string>& dst) {
-  ILA_WARN_IF(!dst.empty()) << "Getting top instr. into non-empty container";
-  for (auto i = 0; i < m.instr_num(); i++) {
-    dst.emplace(m.instr(i).name());
+size_t GetExprNodeNum(const Ila& m) {
+  std::unordered_set<const Expr*> visited;
+  std::vector<ExprPtr> stack;
+
+  auto ila = m.get();
+  for (size_t i = 0; i < ila->instr_num(); i++) {
+    auto instr = ila->instr(i);
+    stack.push_back(instr->decode());
+    for (size_t j = 0; j < ila->state_num(); j++) {
+      stack.push_back(instr->update(ila->state(j)));
+    }
   }
+
+  // DAG traversal (shared sub-expressions are counted once)
+  while (!stack.empty()) {
+    auto expr = stack.back();
+    stack.pop_back();
+    if (expr.get() == nullptr || !visited.insert(expr.get()).second) {
+      continue;
+    }
+    for (size_t i = 0; i < expr->arg_num(); i++) {
+      stack.push_back(expr->arg(i));
+    }
+  }
+
+  return visited.size();
 }
 
 } // namespace ilang
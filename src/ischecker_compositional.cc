@@ -0,0 +1,349 @@
+// =============================================================================
+// MIT License
+//
+// Copyright (c) 2020 Princeton University
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+
+// File: ischecker_compositional.cc
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include <fmt/format.h>
+#include <ilang/ila/instr_lvl_abs.h>
+#include <ilang/target-smt/smt_switch_itf.h>
+#include <ilang/target-smt/z3_expr_adapter.h>
+#include <ilang/util/log.h>
+
+#ifdef USE_Z3
+#include <z3++.h>
+#endif
+
+#include <pffc/ischecker.h>
+
+namespace ilang {
+
+#ifdef USE_Z3
+template class IsChecker<Z3ExprAdapter>;
+#else
+template class IsChecker<SmtSwitchItf>;
+#endif
+
+template <class Generator>
+SmtResult IsChecker<Generator>::CheckCompositional(
+    const std::vector<Segment>& segments) {
+  ILA_INFO << "Start compositional checking (" << segments.size()
+           << " segments)";
+
+#ifdef USE_Z3
+  if (segment_thread_ > 1) {
+    return CheckSegmentParallel(segments);
+  }
+#else
+  ILA_WARN_IF(segment_thread_ > 1)
+      << "Parallel segment checking requires z3, check sequentially";
+#endif
+
+  // segments one by one, stop at the first failing one
+  auto res = SmtResult::UNSAT;
+  auto _check = [this, &res, &segments](const size_t& k,
+                                        Solver<Generator>& solver) {
+    Timer timer;
+    res = solver.Check();
+    RecordQuery(fmt::format("segment {}", k), segments.at(k), res,
+                timer.Elapsed(), solver.GetStatistics());
+    ILA_INFO << "Segment " << k << " result: " << res;
+
+    // states at the segment start are over-approximated, so a counterexample
+    // may be spurious - confirmed by the monolithic check (see Check)
+    ILA_WARN_IF(res == SmtResult::SAT)
+        << "Segment " << k << " may fail due to the free start state";
+    return res == SmtResult::UNSAT;
+  };
+  BuildSegmentQuery(segments, _check);
+  return res;
+}
+
+template <class Generator>
+void IsChecker<Generator>::BuildSegmentQuery(
+    const std::vector<Segment>& segments,
+    const std::function<bool(const size_t&, Solver<Generator>&)>& check) {
+  auto uninterp_func = GetUninterpFunc();
+
+  // control state carried over from the previous segment
+  std::vector<SmtExpr> carry;
+
+  for (auto k = 0; k < segments.size(); k++) {
+    auto& seg = segments.at(k);
+    std::string range;
+    for (auto i = 0; i < m_.size(); i++) {
+      range += fmt::format(" m{} [{}, {})", i, seg.begin.at(i), seg.end.at(i));
+    }
+    ILA_INFO << fmt::format("Segment {}:{}", k, range);
+
+    // unroll the segment only (states at the segment start are free)
+    Solver<Generator> solver(smt_gen_, timeout_);
+    for (const auto& is : UnrollSegment(seg)) {
+      solver.Add(is);
+    }
+    solver.Add(uninterp_func);
+    solver.Add(GetSegmentAssumption(seg, k == 0));
+    for (const auto& c : carry) {
+      solver.Add(c);
+    }
+
+    // non-memory states fixed by the commands are pinned in the next segment
+    if (k + 1 < segments.size()) {
+      carry = GetConstControlState(solver, seg.end);
+      ILA_DLOG("3LA") << carry.size() << " constant states after segment "
+                      << k;
+    }
+
+    solver.Add(GetSegmentViolation(seg));
+    if (!check(k, solver)) {
+      return;
+    }
+  }
+}
+
+#ifdef USE_Z3
+template <class Generator>
+SmtResult IsChecker<Generator>::CheckSegmentParallel(
+    const std::vector<Segment>& segments) {
+  // the violation of a segment only depends on the relation and the carried
+  // state at its start, so it is solved by a worker in its own context while
+  // the next segments are built (the carried state is their input)
+  struct Task {
+    size_t seg;
+    std::unique_ptr<z3::context> ctx;
+    std::unique_ptr<z3::solver> solver;
+  };
+
+  std::deque<Task> tasks;
+  std::set<z3::context*> running;
+  std::mutex mtx;
+  std::condition_variable cv;
+  auto closed = false;
+  std::atomic<bool> stop = false;
+  std::vector<SmtResult> results(segments.size(), SmtResult::UNKNOWN);
+  // per-segment records (char, as the workers write concurrently)
+  std::vector<char> solved(segments.size(), false);
+  std::vector<double> times(segments.size(), 0);
+  std::vector<SolverStat> solver_stats(segments.size());
+
+  // the first failing segment stops the others
+  auto _work = [&tasks, &running, &mtx, &cv, &closed, &stop, &results,
+                &solved, &times, &solver_stats]() {
+    while (true) {
+      Task task;
+      {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock, [&tasks, &closed] { return closed || !tasks.empty(); });
+        if (tasks.empty()) {
+          return;
+        }
+        task = std::move(tasks.front());
+        tasks.pop_front();
+        if (stop) {
+          continue;
+        }
+        running.insert(task.ctx.get());
+      }
+
+      Timer timer;
+      auto res = task.solver->check();
+      solved.at(task.seg) = true;
+      times.at(task.seg) = timer.Elapsed();
+      solver_stats.at(task.seg) =
+          Solver<Generator>::GetStatistics(*task.solver);
+      {
+        std::lock_guard<std::mutex> lock(mtx);
+        running.erase(task.ctx.get());
+      }
+
+      auto& seg_res = results.at(task.seg);
+      seg_res = (res == z3::unsat) ? SmtResult::UNSAT
+                : (res == z3::sat) ? SmtResult::SAT
+                                   : SmtResult::UNKNOWN;
+      ILA_INFO << "Segment " << task.seg << " result: " << seg_res;
+
+      if (seg_res != SmtResult::UNSAT && !stop.exchange(true)) {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (auto other : running) {
+          other->interrupt();
+        }
+      }
+    }
+  };
+
+  auto num_worker = std::min<size_t>(segment_thread_, segments.size());
+  ILA_INFO << fmt::format("Solve segments on {} threads", num_worker);
+  std::vector<std::thread> workers;
+  for (auto i = 0; i < num_worker; i++) {
+    workers.emplace_back(_work);
+  }
+
+  // translated here, contexts are not thread safe (also as the source)
+  auto _submit = [this, &tasks, &mtx, &cv, &stop](const size_t& k,
+                                                  Solver<Generator>& solver) {
+    auto ctx = std::make_unique<z3::context>();
+    auto task_solver = std::make_unique<z3::solver>(*ctx, solver.get(),
+                                                    z3::solver::translate());
+    if (timeout_) {
+      task_solver->set("timeout", timeout_);
+    }
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      tasks.push_back({k, std::move(ctx), std::move(task_solver)});
+    }
+    cv.notify_one();
+    return !stop;
+  };
+  BuildSegmentQuery(segments, _submit);
+
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    closed = true;
+  }
+  cv.notify_all();
+  for (auto& w : workers) {
+    w.join();
+  }
+
+  // segments not solved after a failure are left unknown
+  auto res = SmtResult::UNSAT;
+  for (auto k = 0; k < results.size(); k++) {
+    if (solved.at(k)) {
+      RecordQuery(fmt::format("segment {}", k), segments.at(k), results.at(k),
+                  times.at(k), solver_stats.at(k));
+    }
+    if (results.at(k) == SmtResult::SAT) {
+      ILA_WARN << "Segment " << k << " may fail due to the free start state";
+      return SmtResult::SAT;
+    }
+    if (results.at(k) == SmtResult::UNKNOWN) {
+      res = SmtResult::UNKNOWN;
+    }
+  }
+  return res;
+}
+#endif
+
+template <class Generator>
+bool IsChecker<Generator>::IsValidSegmentation(
+    const std::vector<Segment>& segments) const {
+  if (segments.empty()) {
+    return false;
+  }
+
+  // non-empty, contiguous, and covering all sequences
+  std::vector<size_t> end(m_.size(), 0);
+  for (const auto& seg : segments) {
+    if (seg.begin.size() != m_.size() || seg.end.size() != m_.size()) {
+      return false;
+    }
+    for (auto i = 0; i < m_.size(); i++) {
+      if (seg.begin.at(i) != end.at(i) || seg.end.at(i) <= seg.begin.at(i)) {
+        return false;
+      }
+    }
+    end = seg.end;
+  }
+  return end == GetWholeSegment().end;
+}
+
+template <class Generator>
+std::vector<typename IsChecker<Generator>::SmtExpr>
+IsChecker<Generator>::GetConstControlState(Solver<Generator>& solver,
+                                           const std::vector<size_t>& steps) {
+  // non-memory states at the given steps
+  std::vector<SmtExpr> states;
+  auto _collect = [&states](const Ila& m, PathUnroller<Generator>& unroller,
+                            const size_t& step) {
+    auto ila = m.get();
+    for (size_t i = 0; i < ila->state_num(); i++) {
+      auto var = ila->state(i);
+      if (!var->is_mem()) {
+        states.push_back(unroller.GetSmtCurrent(var, step));
+      }
+    }
+  };
+  for (auto i = 0; i < m_.size(); i++) {
+    _collect(m_.at(i), *unroller_.at(i), steps.at(i));
+  }
+
+  if (solver.Check() != SmtResult::SAT) {
+    return {};
+  }
+
+  std::vector<SmtExpr> values;
+  for (const auto& s : states) {
+    values.push_back(solver.GetValue(s));
+  }
+
+  // drop the states that can take another value until none is left
+  std::vector<bool> is_const(states.size(), true);
+  while (true) {
+    auto diff = smt_gen_.GetShimExpr(BoolConst(false).get());
+    for (auto i = 0; i < states.size(); i++) {
+      if (is_const.at(i)) {
+        auto same = smt_gen_.Equal(states.at(i), values.at(i));
+        diff = BoolOr(diff, BoolNot(same));
+      }
+    }
+
+    solver.Push();
+    solver.Add(diff);
+    auto res = solver.Check();
+    if (res == SmtResult::UNKNOWN) {
+      solver.Pop();
+      return {};
+    }
+    if (res == SmtResult::UNSAT) {
+      solver.Pop();
+      break;
+    }
+
+    for (auto i = 0; i < states.size(); i++) {
+      if (is_const.at(i) &&
+          Solver<Generator>::ToString(solver.GetValue(states.at(i))) !=
+              Solver<Generator>::ToString(values.at(i))) {
+        is_const.at(i) = false;
+      }
+    }
+    solver.Pop();
+  }
+
+  std::vector<SmtExpr> res;
+  for (auto i = 0; i < states.size(); i++) {
+    if (is_const.at(i)) {
+      res.push_back(smt_gen_.Equal(states.at(i), values.at(i)));
+    }
+  }
+  return res;
+}
+
+} // namespace ilang
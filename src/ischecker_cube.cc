@@ -0,0 +1,198 @@
+// =============================================================================
+// MIT License
+//
+// Copyright (c) 2020 Princeton University
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+
+// File: ischecker_cube.cc
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include <fmt/format.h>
+#include <ilang/target-smt/smt_switch_itf.h>
+#include <ilang/target-smt/z3_expr_adapter.h>
+#include <ilang/util/log.h>
+
+#ifdef USE_Z3
+#include <z3++.h>
+#endif
+
+#include <pffc/ischecker.h>
+
+namespace ilang {
+
+#ifdef USE_Z3
+template class IsChecker<Z3ExprAdapter>;
+#else
+template class IsChecker<SmtSwitchItf>;
+#endif
+
+#ifdef USE_Z3
+
+// upper bound of the split bits (number of cubes)
+static const unsigned k_max_cube_bits = 16;
+
+template <class Generator>
+SmtResult IsChecker<Generator>::CheckCube(const std::vector<SmtExpr>& query,
+                                          const std::vector<SmtExpr>& vars) {
+  auto& ctx = smt_gen_.get().context();
+
+  // split bits, the top bit of each variable first, then the next ones
+  std::vector<z3::expr> bits;
+  auto num_bit = std::min(cube_bits_, k_max_cube_bits);
+  for (auto k = 0; k < num_bit; k++) {
+    auto& var = vars.at(k % vars.size());
+    auto depth = k / vars.size();
+    if (depth >= var.get_sort().bv_size()) {
+      break;
+    }
+    auto pos = var.get_sort().bv_size() - 1 - depth;
+    bits.push_back(var.extract(pos, pos) == ctx.bv_val(1, 1));
+  }
+
+  std::vector<z3::expr> cubes;
+  for (size_t c = 0; c < (1ULL << bits.size()); c++) {
+    auto cube = ctx.bool_val(true);
+    for (auto i = 0; i < bits.size(); i++) {
+      cube = cube && (((c >> i) & 1) ? bits.at(i) : !bits.at(i));
+    }
+    cubes.push_back(cube);
+  }
+
+  // one context per worker, with the query and cubes translated up front
+  // (contexts are not thread safe, including as the source of translation)
+  struct Worker {
+    std::unique_ptr<z3::context> ctx;
+    std::unique_ptr<z3::solver> solver;
+    std::vector<z3::expr> cubes;
+  };
+
+  z3::solver base(ctx);
+  for (const auto& e : query) {
+    base.add(e);
+  }
+
+  auto num_thread = cube_thread_ ? cube_thread_
+                                 : std::max(std::thread::hardware_concurrency(),
+                                            1u);
+  std::vector<Worker> workers(std::min<size_t>(num_thread, cubes.size()));
+  for (auto& w : workers) {
+    w.ctx = std::make_unique<z3::context>();
+    w.solver =
+        std::make_unique<z3::solver>(*w.ctx, base, z3::solver::translate());
+    if (timeout_) {
+      w.solver->set("timeout", timeout_);
+    }
+    for (const auto& cube : cubes) {
+      w.cubes.push_back(z3::expr(*w.ctx, Z3_translate(ctx, cube, *w.ctx)));
+    }
+  }
+
+  ILA_INFO << fmt::format("Solve {} cubes on {} threads", cubes.size(),
+                          workers.size());
+  stat_.cube_num = cubes.size();
+
+  // idle workers take the next cube, the first sat cube stops the others
+  std::atomic<size_t> next = 0;
+  std::atomic<bool> found = false;
+  std::atomic<size_t> sat_cube = 0;
+  std::atomic<size_t> num_unknown = 0;
+  // per-cube records (char, as the workers write concurrently)
+  std::vector<char> solved(cubes.size(), false);
+  std::vector<SmtResult> results(cubes.size(), SmtResult::UNKNOWN);
+  std::vector<double> times(cubes.size(), 0);
+  std::vector<SolverStat> solver_stats(cubes.size());
+  auto _work = [&workers, &next, &found, &sat_cube, &num_unknown, &solved,
+                &results, &times, &solver_stats](Worker& w) {
+    for (auto i = next++; i < w.cubes.size() && !found; i = next++) {
+      Timer timer;
+      auto stat_before = Solver<Generator>::GetStatistics(*w.solver);
+      w.solver->push();
+      w.solver->add(w.cubes.at(i));
+      auto res = w.solver->check();
+      w.solver->pop();
+      times.at(i) = timer.Elapsed();
+      solver_stats.at(i) = DiffSolverStat(
+          stat_before, Solver<Generator>::GetStatistics(*w.solver));
+      results.at(i) = (res == z3::unsat) ? SmtResult::UNSAT
+                      : (res == z3::sat) ? SmtResult::SAT
+                                         : SmtResult::UNKNOWN;
+      solved.at(i) = true;
+
+      if (res == z3::sat) {
+        if (!found.exchange(true)) {
+          sat_cube = i;
+          for (auto& other : workers) {
+            other.ctx->interrupt();
+          }
+        }
+      } else if (res == z3::unknown && !found) {
+        ILA_WARN << "Cube " << i << " unknown: " << w.solver->reason_unknown();
+        num_unknown++;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (auto& w : workers) {
+    threads.emplace_back(_work, std::ref(w));
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  workers.clear();
+
+  auto whole = GetWholeSegment();
+  for (auto i = 0; i < cubes.size(); i++) {
+    if (solved.at(i)) {
+      RecordQuery(fmt::format("cube {}", i), whole, results.at(i),
+                  times.at(i), solver_stats.at(i));
+    }
+  }
+
+  if (!found) {
+    return num_unknown ? SmtResult::UNKNOWN : SmtResult::UNSAT;
+  }
+
+  // counterexample in the solving context
+  ILA_INFO << "Cube " << sat_cube << " is sat";
+  Solver<Generator> solver(smt_gen_, timeout_);
+  for (const auto& e : query) {
+    solver.Add(e);
+  }
+  solver.Add(cubes.at(sat_cube));
+  Timer timer;
+  auto res = solver.Check();
+  RecordQuery(fmt::format("cube {} (counterexample)", sat_cube), whole, res,
+              timer.Elapsed(), solver.GetStatistics());
+  if (res == SmtResult::SAT) {
+    auto model = solver.get().get_model();
+    Debug(model);
+  }
+  return SmtResult::SAT;
+}
+
+#endif // USE_Z3
+
+} // namespace ilang
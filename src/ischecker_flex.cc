@@ -107,27 +107,35 @@ void IsCheckerFlexRelay<Generator>::SetFlexCmd(const fs::path& cmd_file) {
   }
 }
 
-template <class Generator> void IsCheckerFlexRelay<Generator>::AddEnvM0() {
+template <class Generator> void IsCheckerFlexRelay<Generator>::AddFlexEnv() {
   ILA_INFO << "Adding flex specific constraints";
   ILA_ASSERT(!cmd_seq_flex_.empty()) << "No Flex command provided";
-  ILA_ASSERT(this->instr_seq_m0_.size() >= cmd_seq_flex_.size());
+  ILA_ASSERT(this->instr_seq_.at(0).size() >= cmd_seq_flex_.size());
+
+  // repeated commands share their constraints
+  CmdExprBuilder builder(this->m_.at(0));
+  store_flex_.clear();
 
   // constraint input of top-level instr.
-  for (auto i = 0, j = 0; i < this->instr_seq_m0_.size(); i++) {
-    auto instr = this->instr_seq_m0_.at(i);
+  for (auto i = 0, j = 0; i < this->instr_seq_.at(0).size(); i++) {
+    auto instr = this->instr_seq_.at(0).at(i);
 
     // only apply to top-level instr
-    if (this->top_instr_m0_.find(instr.name()) == this->top_instr_m0_.end()) {
+    auto& top_instr = this->top_instr_.at(0);
+    if (top_instr.find(instr.name()) == top_instr.end()) {
       continue;
     }
 
     // only constrain on non-data parts
-    auto data_free_cmd = FilterFlexCmd(instr.name(), j);
-    this->unroller_m0_->AssertStep(data_free_cmd.get(), i);
+    auto data_free_cmd = FilterFlexCmd(builder, instr.name(), j, i);
+    this->env_.at(0).push_back({data_free_cmd, i});
 
     // increment cmd ptr
     j++;
   }
+
+  ILA_DLOG("3LA") << builder.num_distinct_cmd() << " distinct of "
+                  << builder.num_cmd() << " flex commands";
 }
 
 static const std::set<std::string> k_data_setup_instr = {
@@ -135,37 +143,56 @@ static const std::set<std::string> k_data_setup_instr = {
 };
 
 template <class Generator>
-ExprRef
-IsCheckerFlexRelay<Generator>::FilterFlexCmd(const std::string& instr_name,
-                                             size_t cmd_idx) {
-  auto& cmd = cmd_seq_flex_[cmd_idx];
-  auto& m = this->m0_;
+std::vector<size_t> IsCheckerFlexRelay<Generator>::GetFlexSegmentStart() {
+  auto& instr_seq_m0 = this->instr_seq_.at(0);
+  auto& top_instr_m0 = this->top_instr_.at(0);
+
+  // a segment starts at the first compute instr. after data setup, or at the
+  // first top-level instr. after the child instr. of the previous layer
+  std::vector<size_t> starts = {0};
+  auto prev_setup = false;
+  auto prev_child = false;
+  for (auto i = 0; i < instr_seq_m0.size(); i++) {
+    auto name = instr_seq_m0.at(i).name();
+    if (top_instr_m0.find(name) == top_instr_m0.end()) {
+      prev_child = true;
+      continue;
+    }
 
-  // read/write
-  auto in_axi_wr = m.input(TOP_IF_WR);
-  auto in_axi_rd = m.input(TOP_IF_RD);
-  auto cmd_expr =
-      (in_axi_wr == cmd.at("is_wr")) & (in_axi_rd == cmd.at("is_rd"));
+    auto is_setup = k_data_setup_instr.find(name) != k_data_setup_instr.end();
+    if (i > 0 && ((prev_setup && !is_setup) || prev_child)) {
+      starts.push_back(i);
+    }
+    prev_setup = is_setup;
+    prev_child = false;
+  }
+  return starts;
+}
+
+template <class Generator>
+ExprRef IsCheckerFlexRelay<Generator>::FilterFlexCmd(
+    CmdExprBuilder& builder, const std::string& instr_name, size_t cmd_idx,
+    size_t step) {
+  auto& cmd = cmd_seq_flex_[cmd_idx];
 
-  // address
+  // read/write and address
   auto addr_val = cmd.at("addr");
-  auto in_axi_addr = m.input(TOP_ADDR_IN);
-  cmd_expr = cmd_expr & (in_axi_addr == addr_val);
+  CmdExprBuilder::FieldVec fields = {{TOP_IF_WR, cmd.at("is_wr")},
+                                     {TOP_IF_RD, cmd.at("is_rd")},
+                                     {TOP_ADDR_IN, addr_val}};
 
   // data setup instr
   if (k_data_setup_instr.find(instr_name) != k_data_setup_instr.end()) {
-    store_flex_.insert({addr_val, cmd_idx});
-    return cmd_expr;
+    store_flex_.insert({addr_val, step});
+    return builder.Command(fields);
   }
 
   // data
   for (auto& data_port : k_flex_in_data) {
-    auto data_inp = m.input(data_port);
-    auto data_val = cmd.at(data_port);
-    cmd_expr = cmd_expr & (data_inp == data_val);
+    fields.push_back({data_port, cmd.at(data_port)});
   }
 
-  return cmd_expr;
+  return builder.Command(fields);
 }
 
 } // namespace ilang
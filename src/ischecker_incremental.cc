@@ -0,0 +1,200 @@
+// =============================================================================
+// MIT License
+//
+// Copyright (c) 2020 Princeton University
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+
+// File: ischecker_incremental.cc
+
+#include <fstream>
+
+#include <fmt/format.h>
+#include <ilang/target-smt/smt_switch_itf.h>
+#include <ilang/target-smt/z3_expr_adapter.h>
+#include <ilang/util/log.h>
+#include <nlohmann/json.hpp>
+
+#include <pffc/ischecker.h>
+#include <pffc/stat.h>
+
+using json = nlohmann::json;
+
+namespace ilang {
+
+#ifdef USE_Z3
+template class IsChecker<Z3ExprAdapter>;
+#else
+template class IsChecker<SmtSwitchItf>;
+#endif
+
+template <class Generator>
+typename IsChecker<Generator>::RunState IsChecker<Generator>::GetRunState() {
+  RunState state;
+
+  // instruction and constraints of each step (data inputs are free, so edits
+  // of the data only do not change them)
+  std::map<std::string, size_t> ids;
+  for (auto i = 0; i < m_.size(); i++) {
+    auto sig = GetStepSignature(instr_seq_.at(i), env_.at(i), ids);
+    std::vector<std::string> keys(ids.size());
+    for (const auto& [key, id] : ids) {
+      keys.at(id) = GetContentHash(key);
+    }
+
+    state.step.push_back({});
+    for (const auto& id : sig) {
+      state.step.back().push_back(keys.at(id));
+    }
+  }
+
+  // identity of the models, e.g., rebuilt with the same commands
+  state.extra = GetExtraInput();
+  std::string passes;
+  for (const auto& pass : passes_) {
+    passes += pass + ";";
+  }
+  state.extra["model:passes"] = passes;
+  for (auto i = 0; i < stat_.node.size(); i++) {
+    state.extra[fmt::format("model:m{}", i)] =
+        fmt::format("{} nodes", stat_.node.at(i));
+  }
+  return state;
+}
+
+template <class Generator>
+std::set<std::string>
+IsChecker<Generator>::GetAffected(const RunState& prev, const RunState& curr,
+                                  const std::vector<Obligation>& obligations) {
+  auto [steps, extra] = DiffRunState(prev, curr);
+
+  // other models - every query may differ
+  for (const auto& key : extra) {
+    if (key.rfind("model:", 0) == 0) {
+      ILA_INFO << "Model changed (" << key << "), all obligations affected";
+      std::set<std::string> all;
+      for (const auto& ob : obligations) {
+        all.insert(ob.name);
+      }
+      return all;
+    }
+  }
+
+  for (auto i = 0; i < steps.size(); i++) {
+    ILA_INFO << fmt::format("m{}: {} steps changed", i, steps.at(i).size());
+  }
+  ILA_INFO_IF(!extra.empty()) << extra.size() << " design inputs changed";
+
+  return GetAffectedObligations(steps, extra);
+}
+
+template <class Generator>
+std::pair<std::vector<std::set<size_t>>, std::set<std::string>>
+IsChecker<Generator>::DiffRunState(const RunState& prev,
+                                   const RunState& curr) {
+  // changed steps by position (all steps after the first difference if the
+  // length changed, since the later steps are shifted)
+  static const std::vector<std::string> none;
+  std::vector<std::set<size_t>> steps(curr.step.size());
+  for (auto i = 0; i < curr.step.size(); i++) {
+    auto& now = curr.step.at(i);
+    auto& old = (i < prev.step.size()) ? prev.step.at(i) : none;
+    auto diverged = false;
+    for (auto j = 0; j < now.size(); j++) {
+      auto diff = j >= old.size() || now.at(j) != old.at(j);
+      diverged |= diff;
+      if ((now.size() == old.size()) ? diff : diverged) {
+        steps.at(i).insert(j);
+      }
+    }
+  }
+
+  std::set<std::string> extra;
+  for (const auto& [key, value] : curr.extra) {
+    auto pos = prev.extra.find(key);
+    if (pos == prev.extra.end() || pos->second != value) {
+      extra.insert(key);
+    }
+  }
+  for (const auto& [key, value] : prev.extra) {
+    if (curr.extra.find(key) == curr.extra.end()) {
+      extra.insert(key);
+    }
+  }
+
+  return {steps, extra};
+}
+
+template <class Generator>
+typename IsChecker<Generator>::RunState
+IsChecker<Generator>::ReadRunState(const fs::path& file) {
+  RunState state;
+  if (!fs::is_regular_file(file)) {
+    ILA_INFO << "No previous run in " << file;
+    return state;
+  }
+
+  std::ifstream fin(file);
+  std::string content((std::istreambuf_iterator<char>(fin)),
+                      std::istreambuf_iterator<char>());
+  fin.close();
+
+  auto reader = json::parse(content, nullptr, false);
+  if (reader.is_discarded() || !reader.is_object()) {
+    ILA_WARN << "Ignore corrupted state " << file;
+    return state;
+  }
+
+  try {
+    state.step = reader.at("step").get<std::vector<std::vector<std::string>>>();
+    state.extra = reader.at("extra").get<std::map<std::string, std::string>>();
+    auto& verdict = reader.at("verdict");
+    for (auto it = verdict.begin(); it != verdict.end(); ++it) {
+      state.verdict[it.key()] = {it.value().at("result").get<std::string>(),
+                                 it.value().at("query").get<std::string>()};
+    }
+  } catch (...) {
+    ILA_WARN << "Ignore corrupted state " << file;
+    return RunState();
+  }
+  return state;
+}
+
+template <class Generator>
+void IsChecker<Generator>::WriteRunState(const fs::path& file,
+                                         const RunState& state) {
+  auto verdict = json::object();
+  for (const auto& [name, rec] : state.verdict) {
+    verdict[name] = {{"result", rec.first}, {"query", rec.second}};
+  }
+
+  // replace the previous state at once
+  auto tmp = file;
+  tmp += ".tmp";
+  std::ofstream fout(tmp);
+  fout << json{{"step", state.step},
+               {"extra", state.extra},
+               {"verdict", verdict}}
+              .dump();
+  fout.close();
+  fs::rename(tmp, file);
+}
+
+} // namespace ilang
@@ -0,0 +1,203 @@
+// =============================================================================
+// MIT License
+//
+// Copyright (c) 2020 Princeton University
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+
+// File: ischecker_inductive.cc
+
+#include <algorithm>
+#include <tuple>
+
+#include <fmt/format.h>
+#include <ilang/target-smt/smt_switch_itf.h>
+#include <ilang/target-smt/z3_expr_adapter.h>
+#include <ilang/util/log.h>
+
+#include <pffc/ischecker.h>
+
+namespace ilang {
+
+#ifdef USE_Z3
+template class IsChecker<Z3ExprAdapter>;
+#else
+template class IsChecker<SmtSwitchItf>;
+#endif
+
+// longest loop iteration (steps) considered
+static const size_t k_max_loop_period = 64;
+
+template <class Generator>
+SmtResult IsChecker<Generator>::CheckInductive(const Loop& loop) {
+  auto k = induction_;
+  // start of iteration j in each model
+  auto _begin = [&loop](size_t j) {
+    std::vector<size_t> steps;
+    for (auto i = 0; i < loop.begin.size(); i++) {
+      steps.push_back(loop.begin.at(i) + j * loop.period.at(i));
+    }
+    return steps;
+  };
+  std::string iter;
+  for (auto i = 0; i < loop.begin.size(); i++) {
+    iter += fmt::format(" m{} {} + {} * j", i, loop.begin.at(i),
+                        loop.period.at(i));
+  }
+  ILA_INFO << fmt::format("Loop of {} iterations:{} ({}-induction)",
+                          loop.num_iter, iter, k);
+
+  auto uninterp_func = GetUninterpFunc();
+  auto _check = [this, &uninterp_func](const std::string& name,
+                                       const Segment& seg,
+                                       const SmtExpr& assumption,
+                                       const SmtExpr& violation) {
+    Solver<Generator> solver(smt_gen_, timeout_);
+    for (const auto& is : UnrollSegment(seg)) {
+      solver.Add(is);
+    }
+    solver.Add(uninterp_func);
+    solver.Add(assumption);
+    solver.Add(violation);
+    Timer timer;
+    auto res = solver.Check();
+    RecordQuery(name, seg, res, timer.Elapsed(), solver.GetStatistics());
+    ILA_INFO << name << " result: " << res;
+    return res;
+  };
+
+  // base case - the invariant holds at the first k + 1 iteration boundaries
+  auto base = Segment{std::vector<size_t>(m_.size(), 0), _begin(k)};
+  auto base_diff = smt_gen_.GetShimExpr(BoolConst(false).get());
+  for (auto j = 0; j <= k; j++) {
+    base_diff = BoolOr(base_diff, BoolNot(GetInvariant(_begin(j))));
+  }
+  auto res = _check("Base case", base, GetSegmentAssumption(base, true),
+                    base_diff);
+  if (res != SmtResult::UNSAT) {
+    return res;
+  }
+
+  // inductive step - k iterations from any state keeping the invariant at
+  // their start keep it at the end (iterations are identical up to the step
+  // number, so the step holds for each window of k iterations)
+  auto step = Segment{_begin(0), _begin(k)};
+  auto step_inv = smt_gen_.GetShimExpr(BoolConst(true).get());
+  for (auto j = 0; j < k; j++) {
+    step_inv = smt_gen_.BoolAnd(step_inv, GetInvariant(_begin(j)));
+  }
+  res = _check("Inductive step", step, step_inv,
+               BoolNot(GetInvariant(_begin(k))));
+  if (res != SmtResult::UNSAT) {
+    // states at the window start are only constrained by the invariant
+    // (confirmed by the monolithic check, see Check)
+    ILA_WARN_IF(res == SmtResult::SAT)
+        << "Invariant may be too weak (not inductive)";
+    return res;
+  }
+
+  // after the loop - from the invariant at the last boundary
+  auto post = Segment{_begin(loop.num_iter), GetWholeSegment().end};
+  res = _check("After loop", post, GetSegmentAssumption(post, false),
+               GetSegmentViolation(post));
+  ILA_WARN_IF(res == SmtResult::SAT)
+      << "Steps after the loop may fail due to the free start state";
+  return res;
+}
+
+template <class Generator>
+std::tuple<size_t, size_t, size_t>
+IsChecker<Generator>::FindPeriodic(const std::vector<size_t>& sig) {
+  auto best = std::make_tuple<size_t, size_t, size_t>(0, 0, 0);
+  size_t best_cover = 0;
+  auto max_period = std::min(k_max_loop_period, sig.size() / 2);
+  for (size_t p = 1; p <= max_period; p++) {
+    // run of steps equal to the step one period later
+    size_t run = 0;
+    for (size_t t = 0; t + p < sig.size(); t++) {
+      run = (sig.at(t) == sig.at(t + p)) ? run + 1 : 0;
+      auto rep = run / p + 1;
+      if (rep >= 2 && rep * p > best_cover) {
+        best = {t + 1 - run, p, rep};
+        best_cover = rep * p;
+      }
+    }
+  }
+  return best;
+}
+
+template <class Generator>
+typename IsChecker<Generator>::Loop IsChecker<Generator>::GetLoop() {
+  std::map<std::string, size_t> ids;
+  auto loop = Loop{{}, {}, 0};
+  for (auto i = 0; i < m_.size(); i++) {
+    auto sig = GetStepSignature(instr_seq_.at(i), env_.at(i), ids);
+    auto [begin, period, rep] = FindPeriodic(sig);
+    ILA_DLOG("3LA") << fmt::format("m{} loop {} + {} * {}", i, begin, period,
+                                   rep);
+
+    // iterations are matched in order, so they must correspond one to one
+    if (i > 0 && rep != loop.num_iter) {
+      ILA_WARN << fmt::format("Loop of m{} has {} iterations, m0 has {}", i,
+                              rep, loop.num_iter);
+      return Loop{{}, {}, 0};
+    }
+    loop.begin.push_back(begin);
+    loop.period.push_back(period);
+    loop.num_iter = rep;
+  }
+  return loop;
+}
+
+template <class Generator>
+std::vector<size_t>
+IsChecker<Generator>::GetStepSignature(const std::vector<InstrRef>& seq,
+                                       const EnvType& env,
+                                       std::map<std::string, size_t>& ids) {
+  // constraints without step suffix, so equal steps have equal strings
+  // (repeated commands share the expression, translate each once)
+  std::map<const Expr*, std::string> cstr_str;
+  std::vector<std::vector<std::string>> step_env(seq.size());
+  for (const auto& [expr, step] : env) {
+    if (step >= seq.size()) {
+      continue;
+    }
+    auto pos = cstr_str.find(expr.get().get());
+    if (pos == cstr_str.end()) {
+      auto str = Solver<Generator>::ToString(smt_gen_.GetShimExpr(expr.get()));
+      pos = cstr_str.emplace(expr.get().get(), str).first;
+    }
+    step_env.at(step).push_back(pos->second);
+  }
+
+  std::vector<size_t> sig;
+  for (auto i = 0; i < seq.size(); i++) {
+    auto& cstr = step_env.at(i);
+    std::sort(cstr.begin(), cstr.end());
+    auto key = seq.at(i).name();
+    for (const auto& c : cstr) {
+      key += "\n" + c;
+    }
+    sig.push_back(ids.emplace(key, ids.size()).first->second);
+  }
+  return sig;
+}
+
+} // namespace ilang
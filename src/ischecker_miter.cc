@@ -27,6 +27,7 @@
 #include <fstream>
 
 #include <fmt/format.h>
+#include <ilang/ila/instr_lvl_abs.h>
 #include <ilang/target-smt/smt_switch_itf.h>
 #include <ilang/target-smt/z3_expr_adapter.h>
 #include <ilang/util/log.h>
@@ -76,31 +77,125 @@ void IsCheckerFlexRelay<Generator>::SetAddrMapping(const fs::path& mapping) {
     auto [it, status] = addr_mapping_.insert({flex_addr, relay_addr});
     ILA_ASSERT(status);
   }
+
+  // hidden/cell state of the LSTM layers (optional), same format
+  if (mapping_reader.contains("lstm state")) {
+    for (const auto& pair : mapping_reader.at("lstm state")) {
+      auto flex_addr_str = pair.at("flex_addr").get<std::string>();
+      auto relay_addr_str = pair.at("relay_addr").get<std::string>();
+      auto flex_addr = StrToULongLong(RemoveHexPrefix(flex_addr_str), 16);
+      auto relay_addr = StrToULongLong(RemoveHexPrefix(relay_addr_str), 16);
+      auto [it, status] = lstm_mapping_.insert({flex_addr, relay_addr});
+      ILA_ASSERT(status);
+    }
+  }
+}
+
+template <class Generator>
+void IsCheckerFlexRelay<Generator>::AddEnv(const size_t& idx) {
+  if (idx == 0) {
+    AddFlexEnv();
+  } else {
+    AddRelayEnv();
+  }
 }
 
 template <class Generator>
 typename IsChecker<Generator>::SmtExpr
-IsCheckerFlexRelay<Generator>::GetMiter() {
+IsCheckerFlexRelay<Generator>::GetPairMiter(const size_t& i, const size_t& j) {
+  ILA_ASSERT(i == 0 && j == 1) << "Flex is only compared with Relay";
   ILA_INFO << "Setting memory relation (miter)";
 
-  auto& m0 = this->m0_;
-  auto& m1 = this->m1_;
-  auto& unroller_m0 = this->unroller_m0_;
-  auto& unroller_m1 = this->unroller_m1_;
-  auto& instr_seq_m0 = this->instr_seq_m0_;
-  auto& instr_seq_m1 = this->instr_seq_m1_;
+  auto flex_end = this->instr_seq_.at(0).size();
+  auto relay_end = this->instr_seq_.at(1).size();
 
-  auto flex_mem = m0.state(GB_CORE_LARGE_BUFFER);
-  auto relay_mem = m1.state(RELAY_TENSOR_MEM);
+  auto same_start = GetStartRelation();
+  auto same_store = GetStoreRelation(0, flex_end, 0, relay_end);
+  auto diff_end = GetEndViolation(flex_end, relay_end);
+
+  return this->smt_gen_.BoolAnd(same_start,
+                                this->smt_gen_.BoolAnd(same_store, diff_end));
+}
+
+template <class Generator>
+std::vector<typename IsChecker<Generator>::Segment>
+IsCheckerFlexRelay<Generator>::GetSegments() {
+  auto flex_starts = GetFlexSegmentStart();
+  auto relay_starts = GetRelaySegmentStart();
+  if (flex_starts.size() != relay_starts.size()) {
+    ILA_ERROR << fmt::format("Segment mismatch: {} in flex, {} in relay",
+                             flex_starts.size(), relay_starts.size());
+    return {};
+  }
+
+  std::vector<typename IsChecker<Generator>::Segment> segments;
+  for (auto k = 0; k < flex_starts.size(); k++) {
+    auto last = (k + 1 == flex_starts.size());
+    segments.push_back(
+        {{flex_starts.at(k), relay_starts.at(k)},
+         {last ? this->instr_seq_.at(0).size() : flex_starts.at(k + 1),
+          last ? this->instr_seq_.at(1).size() : relay_starts.at(k + 1)}});
+  }
+  return segments;
+}
+
+template <class Generator>
+typename IsChecker<Generator>::SmtExpr
+IsCheckerFlexRelay<Generator>::GetSegmentAssumption(
+    const typename IsChecker<Generator>::Segment& seg, const bool& first) {
+  auto pre = first ? GetStartRelation()
+                   : GetEndRelation(seg.begin.at(0), seg.begin.at(1));
+  // LSTM timestep - the hidden/cell state of the previous one
+  if (!first && lstm_relay_.count(seg.begin.at(1))) {
+    pre = this->smt_gen_.BoolAnd(
+        pre, GetLstmRelation(seg.begin.at(0), seg.begin.at(1)));
+  }
+  auto same_store = GetStoreRelation(seg.begin.at(0), seg.end.at(0),
+                                     seg.begin.at(1), seg.end.at(1));
+  return this->smt_gen_.BoolAnd(pre, same_store);
+}
+
+template <class Generator>
+typename IsChecker<Generator>::SmtExpr
+IsCheckerFlexRelay<Generator>::GetSegmentViolation(
+    const typename IsChecker<Generator>::Segment& seg) {
+  auto diff = GetEndViolation(seg.end.at(0), seg.end.at(1));
+  // the hidden/cell state assumed by the next LSTM timestep
+  if (lstm_relay_.count(seg.end.at(1))) {
+    diff = this->BoolOr(
+        diff, this->BoolNot(GetLstmRelation(seg.end.at(0), seg.end.at(1))));
+  }
+  return diff;
+}
+
+template <class Generator>
+typename IsChecker<Generator>::SmtExpr
+IsCheckerFlexRelay<Generator>::GetStartRelation() {
+  auto& unroller_m0 = this->unroller_.at(0);
+  auto& unroller_m1 = this->unroller_.at(1);
+
+  auto flex_mem = this->m_.at(0).state(GB_CORE_LARGE_BUFFER);
+  auto relay_mem = this->m_.at(1).state(RELAY_TENSOR_MEM);
 
-  // start
   auto flex_start = unroller_m0->GetSmtCurrent(flex_mem.get(), 0);
   auto relay_start = unroller_m1->GetSmtCurrent(relay_mem.get(), 0);
-  auto same_start = this->smt_gen_.Equal(flex_start, relay_start);
   ILA_DLOG("3LA") << fmt::format("{} @ 0 == {} @ 0", flex_mem.name(),
                                  relay_mem.name());
 
-  // store
+  return this->smt_gen_.Equal(flex_start, relay_start);
+}
+
+template <class Generator>
+typename IsChecker<Generator>::SmtExpr
+IsCheckerFlexRelay<Generator>::GetStoreRelation(const size_t& flex_begin,
+                                                const size_t& flex_end,
+                                                const size_t& relay_begin,
+                                                const size_t& relay_end) {
+  auto& m0 = this->m_.at(0);
+  auto& m1 = this->m_.at(1);
+  auto& unroller_m0 = this->unroller_.at(0);
+  auto& unroller_m1 = this->unroller_.at(1);
+
   ILA_ASSERT(!store_flex_.empty());
   ILA_ASSERT(!store_relay_.empty());
   ILA_ASSERT(store_flex_.size() * 16 == store_relay_.size());
@@ -111,14 +206,24 @@ IsCheckerFlexRelay<Generator>::GetMiter() {
   for (auto flex_iter : store_flex_) {
     auto flex_addr = flex_iter.first;
     auto flex_step = flex_iter.second;
+    auto flex_in = flex_step >= flex_begin && flex_step < flex_end;
 
     for (auto i = 0; i < 16; i++) {
+      auto relay_addr = addr_mapping_.at(flex_addr + i);
+      auto relay_step = store_relay_.at(relay_addr);
+      auto relay_in = relay_step >= relay_begin && relay_step < relay_end;
+
+      // only relate the stores within the range
+      if (!flex_in || !relay_in) {
+        ILA_WARN_IF(flex_in || relay_in) << fmt::format(
+            "Store {:#x} @ {} / {:#x} @ {} across segment boundary",
+            flex_addr + i, flex_step, relay_addr, relay_step);
+        continue;
+      }
+
       auto flex_in_data = m0.input(k_flex_in_data.at(i));
       auto flex_data =
           unroller_m0->GetSmtCurrent(flex_in_data.get(), flex_step);
-
-      auto relay_addr = addr_mapping_.at(flex_addr + i);
-      auto relay_step = store_relay_.at(relay_addr);
       auto relay_data =
           unroller_m1->GetSmtCurrent(relay_in_data.get(), relay_step);
 
@@ -131,52 +236,330 @@ IsCheckerFlexRelay<Generator>::GetMiter() {
     }
   }
 
-  // end
+  return same_store;
+}
+
+template <class Generator>
+typename IsChecker<Generator>::SmtExpr
+IsCheckerFlexRelay<Generator>::GetInvariant(
+    const std::vector<size_t>& steps) {
+  // memory correspondence of the stored data
+  return GetEndRelation(steps.at(0), steps.at(1));
+}
+
+template <class Generator>
+std::vector<typename IsChecker<Generator>::SmtExpr>
+IsCheckerFlexRelay<Generator>::GetSplitVar() {
+  // stored data (free in flex, related to relay by the store relation), which
+  // feeds the comparisons of maxpooling, in the order of the stores
+  std::vector<typename IsChecker<Generator>::SmtExpr> vars;
+  std::set<size_t> store_step;
+  for (auto flex_iter : store_flex_) {
+    store_step.insert(flex_iter.second);
+  }
+  for (const auto& flex_step : store_step) {
+    for (auto i = 0; i < 16; i++) {
+      auto flex_in_data = this->m_.at(0).input(k_flex_in_data.at(i));
+      vars.push_back(
+          this->unroller_.at(0)->GetSmtCurrent(flex_in_data.get(), flex_step));
+    }
+  }
+  return vars;
+}
+
+template <class Generator>
+typename IsChecker<Generator>::SmtExpr
+IsCheckerFlexRelay<Generator>::GetEndRelation(const size_t& flex_step,
+                                              const size_t& relay_step) {
   auto same_end = this->smt_gen_.GetShimExpr(BoolConst(true).get());
+  for (auto flex_iter : store_flex_) {
+    same_end = this->smt_gen_.BoolAnd(
+        same_end, GetAddrRelation(flex_iter.first, flex_step, relay_step));
+  }
+  return same_end;
+}
+
+template <class Generator>
+typename IsChecker<Generator>::SmtExpr
+IsCheckerFlexRelay<Generator>::GetLstmRelation(const size_t& flex_step,
+                                               const size_t& relay_step) {
+  auto& unroller_m0 = this->unroller_.at(0);
+  auto& unroller_m1 = this->unroller_.at(1);
+
+  auto flex_mem = this->m_.at(0).state(GB_CORE_LARGE_BUFFER);
+  auto relay_mem = this->m_.at(1).state(RELAY_TENSOR_MEM);
 
+  auto same = this->smt_gen_.GetShimExpr(BoolConst(true).get());
+  for (const auto& [flex_addr, relay_addr] : lstm_mapping_) {
+    auto flex_data = Load(flex_mem, flex_addr);
+    auto relay_data = Load(relay_mem, relay_addr);
+    same = this->smt_gen_.BoolAnd(
+        same, this->smt_gen_.Equal(
+                  unroller_m0->GetSmtCurrent(flex_data.get(), flex_step),
+                  unroller_m1->GetSmtCurrent(relay_data.get(), relay_step)));
+  }
+  ILA_DLOG("3LA") << fmt::format("LSTM state @ {} == @ {} ({} bytes)",
+                                 flex_step, relay_step, lstm_mapping_.size());
+  return same;
+}
+
+template <class Generator>
+typename IsChecker<Generator>::SmtExpr
+IsCheckerFlexRelay<Generator>::GetAddrRelation(const size_t& flex_addr,
+                                               const size_t& flex_step,
+                                               const size_t& relay_step) {
+  auto& unroller_m0 = this->unroller_.at(0);
+  auto& unroller_m1 = this->unroller_.at(1);
+
+  auto flex_mem = this->m_.at(0).state(GB_CORE_LARGE_BUFFER);
+  auto relay_mem = this->m_.at(1).state(RELAY_TENSOR_MEM);
+
+  auto same = this->smt_gen_.GetShimExpr(BoolConst(true).get());
+
+  // byte-wise, as the stored data (and the parametric relation)
+  for (auto i = 0; i < 16; i++) {
+    auto flex_data = Load(flex_mem, flex_addr + i);
+    auto end_f = unroller_m0->GetSmtCurrent(flex_data.get(), flex_step);
+    auto relay_addr = addr_mapping_.at(flex_addr + i);
+    auto relay_data = Load(relay_mem, relay_addr);
+    auto end_r = unroller_m1->GetSmtCurrent(relay_data.get(), relay_step);
+
+    same = this->smt_gen_.BoolAnd(same, this->smt_gen_.Equal(end_f, end_r));
+  }
+
+  return same;
+}
+
+template <class Generator>
+std::vector<typename IsChecker<Generator>::Obligation>
+IsCheckerFlexRelay<Generator>::GetObligations() {
+  auto flex_end = this->instr_seq_.at(0).size();
+  auto relay_end = this->instr_seq_.at(1).size();
+
+  // symbolic addresses - one per check
+  if (parametric_addr_) {
+    return {{"parametric", GetParametricEndDiff(flex_end, relay_end)}};
+  }
+
+  // one per stored address
+  std::vector<typename IsChecker<Generator>::Obligation> obligations;
   for (auto flex_iter : store_flex_) {
     auto flex_addr = flex_iter.first;
-    auto flex_data = Load(flex_mem, flex_addr);
-    auto end_f =
-        unroller_m0->GetSmtCurrent(flex_data.get(), instr_seq_m0.size());
+    obligations.push_back(
+        {fmt::format("{:#x}", flex_addr),
+         this->BoolNot(GetAddrRelation(flex_addr, flex_end, relay_end))});
+  }
+  return obligations;
+}
+
+template <class Generator>
+std::map<std::string, std::string>
+IsCheckerFlexRelay<Generator>::GetExtraInput() {
+  std::map<std::string, std::string> extra;
+  for (const auto& [flex_addr, relay_addr] : addr_mapping_) {
+    extra[fmt::format("{:#x}", flex_addr)] = fmt::format("{:#x}", relay_addr);
+  }
+#ifdef FLEX_REV
+  extra["model:flex"] = FLEX_REV;
+#endif
+#ifdef RELAY_REV
+  extra["model:relay"] = RELAY_REV;
+#endif
+  return extra;
+}
+
+template <class Generator>
+std::set<std::string> IsCheckerFlexRelay<Generator>::GetAffectedObligations(
+    const std::vector<std::set<size_t>>& steps,
+    const std::set<std::string>& extra) {
+  if (parametric_addr_) {
+    return {"parametric"};
+  }
 
+  // obligation (stored flex address) of each flex/relay address
+  std::map<size_t, size_t> owner_flex;
+  std::map<size_t, size_t> owner_relay;
+  for (auto flex_iter : store_flex_) {
     for (auto i = 0; i < 16; i++) {
-      auto relay_addr = addr_mapping_.at(flex_addr + i);
-      auto relay_data = Load(relay_mem, relay_addr);
-      auto end_r =
-          unroller_m1->GetSmtCurrent(relay_data.get(), instr_seq_m1.size());
+      owner_flex[flex_iter.first + i] = flex_iter.first;
+      owner_relay[addr_mapping_.at(flex_iter.first + i)] = flex_iter.first;
+    }
+  }
 
-      same_end =
-          this->smt_gen_.BoolAnd(same_end, this->smt_gen_.Equal(end_f, end_r));
+  // the stores of the changed steps, and the changed mapping entries (the
+  // other obligations may still read them, so their query is compared)
+  std::set<std::string> affected;
+  auto _add = [&affected](const std::map<size_t, size_t>& owner,
+                          const size_t& addr) {
+    auto pos = owner.find(addr);
+    if (pos != owner.end()) {
+      affected.insert(fmt::format("{:#x}", pos->second));
+    }
+  };
+  for (auto flex_iter : store_flex_) {
+    if (steps.at(0).count(flex_iter.second)) {
+      _add(owner_flex, flex_iter.first);
+    }
+  }
+  for (auto relay_iter : store_relay_) {
+    if (steps.at(1).count(relay_iter.second)) {
+      _add(owner_relay, relay_iter.first);
     }
   }
+  for (const auto& key : extra) {
+    _add(owner_flex, StrToULongLong(RemoveHexPrefix(key), 16));
+  }
 
-#ifdef USE_Z3
+  return affected;
+}
 
-  return same_start && same_store && !same_end;
+template <class Generator>
+typename IsChecker<Generator>::SmtExpr
+IsCheckerFlexRelay<Generator>::GetEndViolation(const size_t& flex_step,
+                                               const size_t& relay_step) {
+  if (parametric_addr_) {
+    return GetParametricEndDiff(flex_step, relay_step);
+  }
+  return this->BoolNot(GetEndRelation(flex_step, relay_step));
+}
 
-#else
+// ranges shorter than this are enumerated with concrete addresses
+static const size_t k_min_affine_range = 16;
+// bit-width of the symbolic address index
+static const int k_addr_idx_width = 32;
 
-  auto& smt_solver = this->smt_gen_.get().solver();
-#if 0 // sanity check - should be sat
-  return smt_solver->make_term(
-      smt::PrimOp::And, same_start,
-      smt_solver->make_term(smt::PrimOp::And, same_store, same_end));
-#else
-  return smt_solver->make_term(
-      smt::PrimOp::And, same_start,
-      smt_solver->make_term(smt::PrimOp::And, same_store,
-                            smt_solver->make_term(smt::PrimOp::Not, same_end)));
-#endif
+// helper - truncate or extend the index to the address width
+static ExprRef ResizeAddr(const ExprRef& idx, const int& width) {
+  if (idx.bit_width() == width) {
+    return idx;
+  }
+  return (idx.bit_width() > width) ? Extract(idx, width - 1, 0)
+                                   : ZExt(idx, width);
+}
 
-#endif
+// helper - address constant (truncated to the address width as in Load)
+static ExprRef AddrConst(const size_t& addr, const int& width) {
+  auto mask = (width < 64) ? ((1ULL << width) - 1) : ~0ULL;
+  return BvConst(addr & mask, width);
+}
+
+template <class Generator>
+typename IsChecker<Generator>::SmtExpr
+IsCheckerFlexRelay<Generator>::GetParametricEndDiff(
+    const size_t& flex_end, const size_t& relay_end) {
+  auto& m0 = this->m_.at(0);
+  auto& m1 = this->m_.at(1);
+  auto& unroller_m0 = this->unroller_.at(0);
+  auto& unroller_m1 = this->unroller_.at(1);
+
+  auto flex_mem = m0.state(GB_CORE_LARGE_BUFFER);
+  auto relay_mem = m1.state(RELAY_TENSOR_MEM);
+
+  // mapped (byte) addresses of all stored data
+  std::vector<std::pair<size_t, size_t>> addr_pairs;
+  for (auto flex_iter : store_flex_) {
+    for (auto i = 0; i < 16; i++) {
+      auto flex_addr = flex_iter.first + i;
+      addr_pairs.push_back({flex_addr, addr_mapping_.at(flex_addr)});
+    }
+  }
+
+  auto diff_end = this->smt_gen_.GetShimExpr(BoolConst(false).get());
+  auto _add_diff = [this, &diff_end](const auto& cond, const auto& end_f,
+                                     const auto& end_r) {
+    auto diff = this->BoolNot(this->smt_gen_.Equal(end_f, end_r));
+    diff_end = this->BoolOr(diff_end, this->smt_gen_.BoolAnd(cond, diff));
+  };
+  auto always = this->smt_gen_.GetShimExpr(BoolConst(true).get());
+
+  auto ranges = GetAffineRange(addr_pairs);
+  for (auto k = 0; k < ranges.size(); k++) {
+    auto& range = ranges.at(k);
+
+    // irregular - enumerate concrete addresses
+    if (range.size < k_min_affine_range) {
+      for (auto i = 0; i < range.size; i++) {
+        auto flex_data = Load(flex_mem, range.flex_addr + i);
+        auto relay_data = Load(relay_mem, range.relay_addr + i);
+        _add_diff(always, unroller_m0->GetSmtCurrent(flex_data.get(), flex_end),
+                  unroller_m1->GetSmtCurrent(relay_data.get(), relay_end));
+      }
+      continue;
+    }
+
+    // affine - one symbolic address under range constraint
+    auto [idx_f, idx_r] = GetAddrIdx(k);
+    auto flex_addr = AddrConst(range.flex_addr, flex_mem.addr_width()) +
+                     ResizeAddr(idx_f, flex_mem.addr_width());
+    auto relay_addr = AddrConst(range.relay_addr, relay_mem.addr_width()) +
+                      ResizeAddr(idx_r, relay_mem.addr_width());
+    auto in_range = Ult(idx_f, BvConst(range.size, k_addr_idx_width));
+
+    auto cond = this->smt_gen_.BoolAnd(
+        unroller_m0->GetSmtCurrent(in_range.get(), flex_end),
+        this->smt_gen_.Equal(
+            unroller_m0->GetSmtCurrent(idx_f.get(), flex_end),
+            unroller_m1->GetSmtCurrent(idx_r.get(), relay_end)));
+    _add_diff(
+        cond,
+        unroller_m0->GetSmtCurrent(Load(flex_mem, flex_addr).get(), flex_end),
+        unroller_m1->GetSmtCurrent(Load(relay_mem, relay_addr).get(),
+                                   relay_end));
+
+    ILA_DLOG("3LA") << fmt::format("[{:#x}, +{}) -> [{:#x}, +{}) parametric",
+                                   range.flex_addr, range.size,
+                                   range.relay_addr, range.size);
+  }
+
+  return diff_end;
+}
+
+template <class Generator>
+std::pair<ExprRef, ExprRef>
+IsCheckerFlexRelay<Generator>::GetAddrIdx(const size_t& range_idx) {
+  // reuse the index inputs across checks (and checkers of the same model)
+  auto _get_input = [](Ila& m, const std::string& name) {
+    auto ila = m.get();
+    for (size_t i = 0; i < ila->input_num(); i++) {
+      if (ila->input(i)->name().str() == name) {
+        return ExprRef(ila->input(i));
+      }
+    }
+    return m.NewBvInput(name, k_addr_idx_width);
+  };
+
+  while (addr_idx_.size() <= range_idx) {
+    auto name = fmt::format("pffc_addr_idx_{}", addr_idx_.size());
+    addr_idx_.push_back(
+        {_get_input(this->m_.at(0), name), _get_input(this->m_.at(1), name)});
+  }
+  return addr_idx_.at(range_idx);
+}
+
+template <class Generator>
+std::vector<typename IsCheckerFlexRelay<Generator>::AddrRange>
+IsCheckerFlexRelay<Generator>::GetAffineRange(
+    const std::vector<std::pair<size_t, size_t>>& addr_pairs) {
+  std::vector<AddrRange> ranges;
+  for (const auto& [flex_addr, relay_addr] : addr_pairs) {
+    if (!ranges.empty()) {
+      auto& last = ranges.back();
+      if (flex_addr == last.flex_addr + last.size &&
+          relay_addr == last.relay_addr + last.size) {
+        last.size++;
+        continue;
+      }
+    }
+    ranges.push_back({flex_addr, relay_addr, 1});
+  }
+  return ranges;
 }
 
 template <class Generator>
 typename IsChecker<Generator>::SmtExpr
 IsCheckerFlexRelay<Generator>::GetUninterpFunc() {
-  auto& unroller_m0 = this->unroller_m0_;
-  auto& unroller_m1 = this->unroller_m1_;
+  auto& unroller_m0 = this->unroller_.at(0);
+  auto& unroller_m1 = this->unroller_.at(1);
 
   auto interp = this->smt_gen_.GetShimExpr(BoolConst(true).get());
 
@@ -247,12 +630,12 @@ IsCheckerFlexRelay<Generator>::GetUninterpFunc() {
 #ifdef USE_Z3
 template <class Generator>
 void IsCheckerFlexRelay<Generator>::Debug(z3::model& model) {
-  auto& m0 = this->m0_;
-  auto& m1 = this->m1_;
-  auto& unroller_m0 = this->unroller_m0_;
-  auto& unroller_m1 = this->unroller_m1_;
-  auto& instr_seq_m0 = this->instr_seq_m0_;
-  auto& instr_seq_m1 = this->instr_seq_m1_;
+  auto& m0 = this->m_.at(0);
+  auto& m1 = this->m_.at(1);
+  auto& unroller_m0 = this->unroller_.at(0);
+  auto& unroller_m1 = this->unroller_.at(1);
+  auto& instr_seq_m0 = this->instr_seq_.at(0);
+  auto& instr_seq_m1 = this->instr_seq_.at(1);
 
   auto flex_mem = m0.state(GB_CORE_LARGE_BUFFER);
   auto relay_mem = m1.state(RELAY_TENSOR_MEM);
@@ -0,0 +1,334 @@
+// =============================================================================
+// MIT License
+//
+// Copyright (c) 2020 Princeton University
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+
+// File: ischecker_obligation.cc
+
+#include <map>
+#include <set>
+
+#include <fmt/format.h>
+#include <ilang/target-smt/smt_switch_itf.h>
+#include <ilang/target-smt/z3_expr_adapter.h>
+#include <ilang/util/log.h>
+
+#ifdef USE_Z3
+#include <z3++.h>
+#endif
+
+#include <pffc/ischecker.h>
+
+namespace ilang {
+
+#ifdef USE_Z3
+template class IsChecker<Z3ExprAdapter>;
+#else
+template class IsChecker<SmtSwitchItf>;
+#endif
+
+template <class Generator> SmtResult IsChecker<Generator>::CheckObligations() {
+  // unsat only if all obligations are
+  auto res = SmtResult::UNSAT;
+  auto _merge = [&res](const SmtResult& r) {
+    if (r == SmtResult::SAT || res == SmtResult::SAT) {
+      res = SmtResult::SAT;
+    } else if (r == SmtResult::UNKNOWN) {
+      res = SmtResult::UNKNOWN;
+    }
+  };
+  auto _key = [this](const Obligation& ob) {
+    return fmt::format("{}/{}", journal_prefix_, ob.name);
+  };
+
+  // incremental - inputs and verdicts of the previous run and this one
+  auto incremental = !incremental_.empty();
+  auto prev_run = incremental ? ReadRunState(incremental_) : RunState();
+  auto curr_run = incremental ? GetRunState() : RunState();
+
+  // skip the finished ones
+  auto obligations = GetObligations();
+  std::vector<size_t> todo;
+  for (auto i = 0; i < obligations.size(); i++) {
+    auto& ob = obligations.at(i);
+    auto rec = journal_ ? journal_->Find(_key(ob)) : nullptr;
+    if (rec) {
+      _merge(ToSmtResult(rec->result));
+      // reusable in the next run if the inputs stay the same
+      curr_run.verdict[ob.name] = {rec->result, ""};
+    } else {
+      todo.push_back(i);
+    }
+  }
+
+  stat_.obligation_num = obligations.size();
+  stat_.obligation_skipped = obligations.size() - todo.size();
+  ILA_INFO << fmt::format("{} obligations, {} finished before",
+                          obligations.size(), stat_.obligation_skipped);
+
+  // shared by all obligations (unrolled when first needed)
+  auto whole = GetWholeSegment();
+  std::vector<SmtExpr> base;
+  auto _base = [this, &whole, &base]() -> const std::vector<SmtExpr>& {
+    if (base.empty()) {
+      base = UnrollSegment(whole);
+      base.push_back(GetUninterpFunc());
+      base.push_back(GetSegmentAssumption(whole, true));
+    }
+    return base;
+  };
+
+  // incremental - reuse the verdicts of the previous run if the inputs are
+  // the same, or if the obligation is not affected and has the same query
+  auto same_input = prev_run.step == curr_run.step &&
+                    prev_run.extra == curr_run.extra;
+  auto affected = (incremental && !same_input)
+                      ? GetAffected(prev_run, curr_run, obligations)
+                      : std::set<std::string>();
+  ILA_INFO_IF(incremental) << fmt::format(
+      "Inputs {}, {} obligations affected", same_input ? "same" : "changed",
+      affected.size());
+
+  std::vector<size_t> remain;
+  std::map<size_t, std::string> fingerprint;
+  for (auto i : todo) {
+    auto& ob = obligations.at(i);
+    if (!incremental) {
+      remain.push_back(i);
+      continue;
+    }
+
+    // the fingerprint simplifies the whole query, so it is only computed for
+    // the unaffected obligations with a fingerprint to compare (recorded when
+    // merging the obligations, where it is computed anyway)
+    auto prev = prev_run.verdict.find(ob.name);
+    auto known = prev != prev_run.verdict.end() &&
+                 ToSmtResult(prev->second.first) != SmtResult::UNKNOWN;
+    if (same_input && known) {
+      fingerprint[i] = prev->second.second;
+    } else if (known && !prev->second.second.empty() &&
+               !affected.count(ob.name)) {
+      fingerprint[i] = GetQueryFingerprint(_base(), ob.violation);
+    }
+    auto& query = fingerprint[i];
+    auto reuse = known && (same_input ||
+                           (!query.empty() && query == prev->second.second));
+    if (!reuse) {
+      curr_run.verdict[ob.name] = {ToString(SmtResult::UNKNOWN), ""};
+      remain.push_back(i);
+      continue;
+    }
+
+    curr_run.verdict[ob.name] = prev->second;
+    if (journal_) {
+      journal_->Done(_key(ob), {prev->second.first, 0, ""});
+    }
+    _merge(ToSmtResult(prev->second.first));
+    stat_.obligation_reused++;
+  }
+  ILA_INFO_IF(incremental) << fmt::format("{} verdicts reused",
+                                          stat_.obligation_reused);
+
+  if (remain.empty()) {
+    if (incremental) {
+      WriteRunState(incremental_, curr_run);
+    }
+    return res;
+  }
+
+  Solver<Generator> solver(smt_gen_, timeout_);
+  for (const auto& e : _base()) {
+    solver.Add(e);
+  }
+
+  // one query per group, the others take the verdict of the first
+  auto groups = GroupObligations(obligations, remain, _base(), fingerprint);
+  stat_.obligation_group = groups.size();
+
+  for (const auto& group : groups) {
+    auto& rep = obligations.at(group.front());
+    if (journal_) {
+      journal_->Start(_key(rep));
+    }
+
+    Timer timer;
+    auto stat_before = solver.GetStatistics();
+    solver.Push();
+    solver.Add(rep.violation);
+    auto ob_res = solver.Check();
+    auto stat_after = solver.GetStatistics();
+    auto witness = (ob_res == SmtResult::SAT) ? GetWitness(solver) : "";
+    solver.Pop();
+    auto time = timer.Elapsed();
+    RecordQuery(rep.name, whole, ob_res, time,
+                DiffSolverStat(stat_before, stat_after));
+
+    for (auto i : group) {
+      auto& ob = obligations.at(i);
+      if (incremental) {
+        curr_run.verdict.at(ob.name) = {ToString(ob_res), fingerprint[i]};
+      }
+      if (journal_ && i == group.front()) {
+        journal_->Done(_key(ob), {ToString(ob_res), time, witness});
+      } else if (journal_) {
+        auto same = (ob_res == SmtResult::SAT) ? "as " + rep.name : "";
+        journal_->Done(_key(ob), {ToString(ob_res), 0, same});
+      }
+    }
+    ILA_INFO << fmt::format("{}: {} ({} obligations)", _key(rep),
+                            ToString(ob_res), group.size());
+    _merge(ob_res);
+  }
+
+  if (incremental) {
+    WriteRunState(incremental_, curr_run);
+  }
+  return res;
+}
+
+#ifdef USE_Z3
+// helper - the query simplified (equisatisfiable), with the constants renamed
+// in the order of occurrence, i.e., equal for queries equal up to renaming
+static std::string GetCanonicalQuery(z3::context& ctx,
+                                     const std::vector<z3::expr>& query) {
+  z3::goal goal(ctx);
+  for (const auto& e : query) {
+    goal.add(e);
+  }
+
+  auto _t = [&ctx](const char* name) { return z3::tactic(ctx, name); };
+  auto pipeline = _t("simplify") & _t("propagate-values") & _t("solve-eqs") &
+                  _t("elim-uncnstr") & _t("simplify");
+  auto simplified = pipeline(goal);
+
+  auto residual = ctx.bool_val(false);
+  for (auto i = 0; i < simplified.size(); i++) {
+    residual = residual || simplified[i].as_expr();
+  }
+
+  // constants in pre-order
+  z3::expr_vector src(ctx);
+  z3::expr_vector dst(ctx);
+  std::set<unsigned> visited;
+  std::vector<z3::expr> stack = {residual};
+  while (!stack.empty()) {
+    auto e = stack.back();
+    stack.pop_back();
+    if (!e.is_app() || !visited.insert(e.id()).second) {
+      continue;
+    }
+    if (e.is_const() && e.decl().decl_kind() == Z3_OP_UNINTERPRETED) {
+      src.push_back(e);
+      dst.push_back(ctx.constant(fmt::format("c!{}", dst.size()).c_str(),
+                                 e.get_sort()));
+      continue;
+    }
+    for (auto j = e.num_args(); j > 0; j--) {
+      stack.push_back(e.arg(j - 1));
+    }
+  }
+
+  return residual.substitute(src, dst).to_string();
+}
+#endif
+
+template <class Generator>
+std::string
+IsChecker<Generator>::GetQueryFingerprint(const std::vector<SmtExpr>& base,
+                                          const SmtExpr& violation) {
+#ifdef USE_Z3
+  auto query = base;
+  query.push_back(violation);
+  return GetContentHash(GetCanonicalQuery(smt_gen_.get().context(), query));
+#else
+  return "";
+#endif
+}
+
+template <class Generator>
+std::vector<std::vector<size_t>> IsChecker<Generator>::GroupObligations(
+    const std::vector<Obligation>& obligations, const std::vector<size_t>& todo,
+    const std::vector<SmtExpr>& base,
+    std::map<size_t, std::string>& fingerprint) {
+  std::vector<std::vector<size_t>> groups;
+  if (!merge_obligation_) {
+    for (auto i : todo) {
+      groups.push_back({i});
+    }
+    return groups;
+  }
+
+#ifdef USE_Z3
+  std::map<std::string, size_t> group_idx;
+  for (auto i : todo) {
+    auto key = fingerprint[i];
+    if (key.empty()) {
+      key = GetQueryFingerprint(base, obligations.at(i).violation);
+      fingerprint[i] = key;
+    }
+
+    auto [pos, is_new] = group_idx.emplace(key, groups.size());
+    if (is_new) {
+      groups.push_back({});
+    }
+    groups.at(pos->second).push_back(i);
+  }
+  ILA_INFO << fmt::format("{} obligations in {} groups", todo.size(),
+                          groups.size());
+#else
+  ILA_WARN << "Merging obligations requires z3";
+  for (auto i : todo) {
+    groups.push_back({i});
+  }
+#endif
+
+  return groups;
+}
+
+template <class Generator>
+std::vector<typename IsChecker<Generator>::Obligation>
+IsChecker<Generator>::GetObligations() {
+  auto pairs = GetMiterPairs();
+  if (pairs.size() == 1) {
+    return {{"miter", GetMiter()}};
+  }
+
+  std::vector<Obligation> obligations;
+  for (const auto& [i, j] : pairs) {
+    obligations.push_back({fmt::format("m{}_m{}", i, j), GetPairMiter(i, j)});
+  }
+  return obligations;
+}
+
+template <class Generator>
+std::string IsChecker<Generator>::GetWitness(Solver<Generator>& solver) {
+  // values of the split variables (the free data of the design)
+  std::string witness;
+  for (const auto& var : GetSplitVar()) {
+    witness += fmt::format("{}{} = {}", witness.empty() ? "" : ", ",
+                           Solver<Generator>::ToString(var),
+                           Solver<Generator>::ToString(solver.GetValue(var)));
+  }
+  return witness;
+}
+
+} // namespace ilang
@@ -25,9 +25,11 @@
 // File: ischecker_relay.cc
 
 #include <fstream>
+#include <map>
 #include <set>
 
 //#include <csv.hpp>
+#include <fmt/format.h>
 #include <ilang/target-smt/smt_switch_itf.h>
 #include <ilang/target-smt/z3_expr_adapter.h>
 #include <ilang/util/log.h>
@@ -35,6 +37,7 @@
 #include <nlohmann/json.hpp>
 
 #include <relay/relay_func_call.h>
+#include <relay/relay_lstm.h>
 #include <relay/relay_maxpooling.h>
 
 #include <pffc/ischecker_flex_relay.h>
@@ -59,19 +62,34 @@ void IsCheckerFlexRelay<Generator>::SetRelayCmd(const fs::path& cmd_file) {
   fin >> cmd_reader;
   fin.close();
 
-  static const std::set<std::string> relay_cmd_fields = {
-      "data_in",     "data_in_x",   "data_in_y", "func_id", "func_run",
-      "pool_size_x", "pool_size_y", "stride_x",  "stride_y"};
+  // fields of each function (besides func_id and func_run)
+  static const std::map<unsigned long long, std::set<std::string>>
+      relay_cmd_fields = {
+          {F_TENSOR_STORE_ID, {"data_in", "data_in_y"}},
+          {F_MAXPOOLING_2D_ID,
+           {"data_in", "data_in_x", "data_in_y", "pool_size_x", "pool_size_y",
+            "stride_x", "stride_y"}},
+          {F_LSTM_ID,
+           {"num_vector_in", "num_vector_out", "num_timestep", "is_bias"}}};
 
   for (auto& cmd : cmd_reader.at("command inputs")) {
     cmd_seq_relay_.push_back(CmdType());
     auto& curr = cmd_seq_relay_.back();
 
+    auto _parse = [this, &cmd, &curr](const std::string& field) {
+      auto value_str = cmd.at(field).get<std::string>();
+      curr[field] = StrToULongLong(RemoveHexPrefix(value_str), 16);
+    };
+
     try {
-      for (auto& field : relay_cmd_fields) {
-        auto value_str = cmd.at(field).get<std::string>();
-        auto value = StrToULongLong(RemoveHexPrefix(value_str), 16);
-        curr[field] = value;
+      _parse("func_id");
+      _parse("func_run");
+      // other functions are only constrained by func_id and func_run
+      auto fields = relay_cmd_fields.find(curr.at("func_id"));
+      if (fields != relay_cmd_fields.end()) {
+        for (auto& field : fields->second) {
+          _parse(field);
+        }
       }
     } catch (...) {
       ILA_ERROR << "Fail parsing command " << cmd;
@@ -79,15 +97,21 @@ void IsCheckerFlexRelay<Generator>::SetRelayCmd(const fs::path& cmd_file) {
   }
 }
 
-template <class Generator> void IsCheckerFlexRelay<Generator>::AddEnvM1() {
-  auto& instr_seq_m1 = this->instr_seq_m1_;
-  auto& top_instr_m1 = this->top_instr_m1_;
-  auto& unroller_m1 = this->unroller_m1_;
+template <class Generator> void IsCheckerFlexRelay<Generator>::AddRelayEnv() {
+  auto& instr_seq_m1 = this->instr_seq_.at(1);
+  auto& top_instr_m1 = this->top_instr_.at(1);
+  auto& env_m1 = this->env_.at(1);
 
   ILA_INFO << "Adding relay specific constraints";
   ILA_ASSERT(!cmd_seq_relay_.empty()) << "No Relay command provided";
   ILA_ASSERT(instr_seq_m1.size() >= cmd_seq_relay_.size());
 
+  // repeated commands share their constraints
+  CmdExprBuilder builder(this->m_.at(1));
+
+  store_relay_.clear();
+  lstm_relay_.clear();
+
   // constraint input of top-level instr
   for (auto i = 0, j = 0; i < instr_seq_m1.size(); i++) {
     auto instr = instr_seq_m1.at(i);
@@ -98,47 +122,83 @@ template <class Generator> void IsCheckerFlexRelay<Generator>::AddEnvM1() {
     }
 
     // only constrain on non-data parts
-    auto data_free_cmd = FilterRelayCmd(instr.name(), j);
-    unroller_m1->AssertStep(data_free_cmd.get(), i);
+    auto data_free_cmd = FilterRelayCmd(builder, instr.name(), j, i);
+    env_m1.push_back({data_free_cmd, i});
+    if (cmd_seq_relay_.at(j).at("func_id") == F_LSTM_ID) {
+      lstm_relay_.insert(i);
+    }
 
     // increment cmd ptr
     j++;
   }
+
+  ILA_DLOG("3LA") << builder.num_distinct_cmd() << " distinct of "
+                  << builder.num_cmd() << " relay commands";
+  ILA_WARN_IF(!lstm_relay_.empty() && lstm_mapping_.empty())
+      << "No LSTM state mapping, the hidden/cell state is not related";
 }
 
 template <class Generator>
-ExprRef
-IsCheckerFlexRelay<Generator>::FilterRelayCmd(const std::string& instr_name,
-                                              size_t cmd_idx) {
-  auto& m1 = this->m1_;
+std::vector<size_t> IsCheckerFlexRelay<Generator>::GetRelaySegmentStart() {
+  auto& instr_seq_m1 = this->instr_seq_.at(1);
+  auto& top_instr_m1 = this->top_instr_.at(1);
 
+  // a segment starts whenever the called function changes, and at each LSTM
+  // call (one per timestep, the hidden/cell state is kept in the memory)
+  std::vector<size_t> starts = {0};
+  for (auto i = 0, j = 0; i < instr_seq_m1.size(); i++) {
+    if (top_instr_m1.find(instr_seq_m1.at(i).name()) == top_instr_m1.end()) {
+      continue;
+    }
+
+    auto func_id = cmd_seq_relay_.at(j).at("func_id");
+    if (j > 0 && (func_id != cmd_seq_relay_.at(j - 1).at("func_id") ||
+                  func_id == F_LSTM_ID)) {
+      starts.push_back(i);
+    }
+    j++;
+  }
+  return starts;
+}
+
+template <class Generator>
+ExprRef IsCheckerFlexRelay<Generator>::FilterRelayCmd(
+    CmdExprBuilder& builder, const std::string& instr_name, size_t cmd_idx,
+    size_t step) {
   auto& cmd = cmd_seq_relay_[cmd_idx];
   auto func_id = cmd.at("func_id");
   auto func_run = cmd.at("func_run");
 
   // func_run & func_id
-  auto cmd_expr = (m1.input(RELAY_FUNC_RUN_IN) == func_run) &
-                  (m1.input(RELAY_FUNC_ID_IN) == func_id);
+  CmdExprBuilder::FieldVec fields = {{RELAY_FUNC_RUN_IN, func_run},
+                                     {RELAY_FUNC_ID_IN, func_id}};
 
   if (func_id == F_TENSOR_STORE_ID) {
     auto addr = cmd.at("data_in_y");
-    cmd_expr = cmd_expr & (m1.input(DATA_IN_Y) == cmd.at("data_in_y"));
-    store_relay_.insert({addr, cmd_idx});
+    fields.push_back({DATA_IN_Y, addr});
+    store_relay_.insert({addr, step});
 
   } else if (func_id == F_MAXPOOLING_2D_ID) {
-    cmd_expr = cmd_expr & (m1.input(RELAY_DATA_IN) == cmd.at("data_in"));
-    cmd_expr = cmd_expr & (m1.input(DATA_IN_Y) == cmd.at("data_in_y"));
-    cmd_expr = cmd_expr & (m1.input(DATA_IN_X) == cmd.at("data_in_x"));
-    cmd_expr = cmd_expr & (m1.input(POOL_SIZE_Y_IN) == cmd.at("pool_size_y"));
-    cmd_expr = cmd_expr & (m1.input(POOL_SIZE_X_IN) == cmd.at("pool_size_x"));
-    cmd_expr = cmd_expr & (m1.input(STRIDES_Y_IN) == cmd.at("stride_y"));
-    cmd_expr = cmd_expr & (m1.input(STRIDES_X_IN) == cmd.at("stride_x"));
+    fields.push_back({RELAY_DATA_IN, cmd.at("data_in")});
+    fields.push_back({DATA_IN_Y, cmd.at("data_in_y")});
+    fields.push_back({DATA_IN_X, cmd.at("data_in_x")});
+    fields.push_back({POOL_SIZE_Y_IN, cmd.at("pool_size_y")});
+    fields.push_back({POOL_SIZE_X_IN, cmd.at("pool_size_x")});
+    fields.push_back({STRIDES_Y_IN, cmd.at("stride_y")});
+    fields.push_back({STRIDES_X_IN, cmd.at("stride_x")});
 
   } else if (func_id == F_LSTM_ID) {
-    // TODO
+    auto num_timestep = cmd.at("num_timestep");
+    fields.push_back({LSTM_NUM_VECTOR_IN, cmd.at("num_vector_in")});
+    fields.push_back({LSTM_NUM_VECTOR_OUT, cmd.at("num_vector_out")});
+    fields.push_back({LSTM_NUM_TIMESTEP, num_timestep});
+    fields.push_back({LSTM_IS_BIAS, cmd.at("is_bias")});
+    ILA_WARN_IF(num_timestep > 1) << fmt::format(
+        "LSTM call {} of {} timesteps is checked as one segment", cmd_idx,
+        num_timestep);
   }
 
-  return cmd_expr;
+  return builder.Command(fields);
 }
 
 } // namespace ilang
@@ -0,0 +1,181 @@
+// =============================================================================
+// MIT License
+//
+// Copyright (c) 2020 Princeton University
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+
+// File: ischecker_unroll.cc
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <thread>
+
+#include <fmt/format.h>
+#include <ilang/target-smt/smt_switch_itf.h>
+#include <ilang/target-smt/z3_expr_adapter.h>
+#include <ilang/util/log.h>
+
+#ifdef USE_Z3
+#include <z3++.h>
+#endif
+
+#include <pffc/ischecker.h>
+
+namespace ilang {
+
+#ifdef USE_Z3
+template class IsChecker<Z3ExprAdapter>;
+#else
+template class IsChecker<SmtSwitchItf>;
+#endif
+
+// minimum number of steps unrolled by one thread
+static const size_t k_min_unroll_chunk = 8;
+
+template <class Generator>
+std::vector<typename IsChecker<Generator>::SmtExpr>
+IsChecker<Generator>::UnrollSegment(const Segment& seg) {
+  Timer timer;
+
+#ifdef USE_Z3
+  if (unroll_thread_ > 1) {
+    auto res = UnrollParallel(seg);
+    stat_.unroll_time += timer.Elapsed();
+    return res;
+  }
+#else
+  ILA_WARN_IF(unroll_thread_ > 1)
+      << "Parallel unrolling requires z3, unroll sequentially";
+#endif
+
+  // states are named by step, so the unrollers share them via smt_gen_
+  auto _unroll = [this](size_t idx, size_t begin, size_t end) {
+    auto& seq = instr_seq_.at(idx);
+    auto& env = env_.at(idx);
+    PathUnroller<Generator> unroller(smt_gen_);
+    AssertEnv(unroller, env, begin, end);
+    return unroller.Unroll(GetInstrVec(seq, begin, end), begin);
+  };
+
+  std::vector<SmtExpr> res;
+  for (auto i = 0; i < m_.size(); i++) {
+    res.push_back(_unroll(i, seg.begin.at(i), seg.end.at(i)));
+  }
+
+  stat_.unroll_time += timer.Elapsed();
+  return res;
+}
+
+#ifdef USE_Z3
+template <class Generator>
+std::vector<typename IsChecker<Generator>::SmtExpr>
+IsChecker<Generator>::UnrollParallel(const Segment& seg) {
+  // steps [begin, end) of one model, unrolled in its own context
+  struct Chunk {
+    size_t idx;
+    size_t begin;
+    size_t end;
+    std::unique_ptr<z3::context> ctx;
+    std::unique_ptr<z3::expr> is;
+  };
+
+  // split each sequence evenly, the threads shared among the models
+  std::vector<Chunk> chunks;
+  auto num_chunk = std::max<size_t>(unroll_thread_ / m_.size(), 1);
+  auto _split = [this, &chunks, &num_chunk](size_t idx, size_t begin,
+                                            size_t end) {
+    auto size = std::max((end - begin + num_chunk - 1) / num_chunk,
+                         k_min_unroll_chunk);
+    for (auto i = begin; i < end; i += size) {
+      chunks.push_back({idx, i, std::min(i + size, end), nullptr, nullptr});
+    }
+  };
+  for (auto i = 0; i < m_.size(); i++) {
+    _split(i, seg.begin.at(i), seg.end.at(i));
+  }
+
+  // merge into the solving context (same names give the same terms)
+  auto& ctx = smt_gen_.get().context();
+  std::vector<z3::expr> res(m_.size(), ctx.bool_val(true));
+  auto _merge = [&ctx, &res](Chunk& chunk) {
+    auto term = z3::expr(ctx, Z3_translate(*chunk.ctx, *chunk.is, ctx));
+    res.at(chunk.idx) = res.at(chunk.idx) && term;
+    // release the chunk context
+    chunk.is.reset();
+    chunk.ctx.reset();
+  };
+
+  auto _unroll = [this](Chunk& chunk) {
+    auto& seq = instr_seq_.at(chunk.idx);
+    auto& env = env_.at(chunk.idx);
+
+    chunk.ctx = std::make_unique<z3::context>();
+    {
+      auto gen = Z3ExprAdapter(*chunk.ctx);
+      auto shim = SmtShim(gen);
+      PathUnroller<Z3ExprAdapter> unroller(shim);
+      AssertEnv(unroller, env, chunk.begin, chunk.end);
+      chunk.is = std::make_unique<z3::expr>(unroller.Unroll(
+          GetInstrVec(seq, chunk.begin, chunk.end), chunk.begin));
+    }
+  };
+
+  // ILA models are only read, each context is owned by one thread
+  std::atomic<size_t> next = 0;
+  std::vector<std::exception_ptr> errors(chunks.size());
+  auto _work = [&chunks, &next, &errors, &_unroll]() {
+    for (auto i = next++; i < chunks.size(); i = next++) {
+      try {
+        _unroll(chunks.at(i));
+      } catch (...) {
+        errors.at(i) = std::current_exception();
+      }
+    }
+  };
+
+  auto num_worker = std::min<size_t>(unroll_thread_, chunks.size());
+  ILA_INFO << fmt::format("Unroll {} chunks on {} threads", chunks.size(),
+                          num_worker);
+  std::vector<std::thread> workers;
+  for (auto i = 0; i < num_worker; i++) {
+    workers.emplace_back(_work);
+  }
+  for (auto& w : workers) {
+    w.join();
+  }
+
+  for (auto& e : errors) {
+    if (e) {
+      std::rethrow_exception(e);
+    }
+  }
+
+  for (auto& chunk : chunks) {
+    _merge(chunk);
+  }
+
+  return res;
+}
+#endif
+
+} // namespace ilang
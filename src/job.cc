@@ -0,0 +1,293 @@
+// =============================================================================
+// MIT License
+//
+// Copyright (c) 2020 Princeton University
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+
+// File: job.cc
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <fmt/format.h>
+#include <ilang/ilang++.h>
+#include <ilang/target-smt/smt_shim.h>
+#include <ilang/target-smt/smt_switch_itf.h>
+#include <ilang/target-smt/z3_expr_adapter.h>
+#include <ilang/util/log.h>
+#include <nlohmann/json.hpp>
+
+#ifdef USE_Z3
+#include <z3++.h>
+#else
+#include <smt-switch/boolector_factory.h>
+#include <smt-switch/smt.h>
+#endif
+
+#include <flex/interface.h>
+#include <relay/interface.h>
+
+#include <pffc/ischecker_flex_relay.h>
+#include <pffc/job.h>
+
+using json = nlohmann::json;
+
+namespace ilang {
+
+Job ReadJob(const fs::path& file) {
+  ILA_ASSERT(fs::is_regular_file(file)) << file;
+
+  std::ifstream fin(file);
+  json job_reader;
+  fin >> job_reader;
+  fin.close();
+
+  auto base_dir = file.parent_path();
+  auto _get_path = [&job_reader, &base_dir](const std::string& field) {
+    return base_dir / job_reader.at(field).get<std::string>();
+  };
+
+  Job job;
+  job.name = job_reader.value("name", file.stem().string());
+  job.instr_seq_flex = _get_path("instr_seq_flex");
+  job.instr_seq_relay = _get_path("instr_seq_relay");
+  job.cmd_flex = _get_path("cmd_flex");
+  job.cmd_relay = _get_path("cmd_relay");
+  job.addr_mapping = _get_path("addr_mapping");
+
+  if (job_reader.contains("passes")) {
+    job.passes = job_reader.at("passes").get<std::vector<std::string>>();
+  }
+  job.parametric_addr = job_reader.value("parametric_addr", false);
+  job.compositional = job_reader.value("compositional", false);
+  job.induction = job_reader.value("induction", 0u);
+  job.merge_obligations = job_reader.value("merge_obligations", false);
+  job.segment_thread = job_reader.value("segment_thread", 1u);
+  job.unroll_thread = job_reader.value("unroll_thread", 1u);
+  job.sat_solver = job_reader.value("sat_solver", "");
+  if (job_reader.contains("cnf_cache")) {
+    job.cnf_cache = _get_path("cnf_cache");
+  }
+  job.cube_bits = job_reader.value("cube_bits", 0u);
+  job.cube_thread = job_reader.value("cube_thread", 0u);
+  if (job_reader.contains("incremental")) {
+    job.incremental = _get_path("incremental");
+  }
+  if (job_reader.contains("stat_out")) {
+    job.stat_out = _get_path("stat_out");
+  }
+  job.priority = job_reader.value("priority", 0);
+  job.timeout = job_reader.value("timeout", 0u);
+
+  return job;
+}
+
+Job GetDefaultJob(const fs::path& data_dir) {
+  Job job;
+  job.name = "default";
+  job.instr_seq_flex = data_dir / "instr_seq_flex_small.json";
+  job.instr_seq_relay = data_dir / "instr_seq_relay_small.json";
+  job.cmd_flex = data_dir / "prog_frag_flex.json";
+  job.cmd_relay = data_dir / "prog_frag_relay.json";
+  job.addr_mapping = data_dir / "addr_mapping.json";
+  return job;
+}
+
+bool HasJobInput(const Job& job) {
+  for (const auto& file : {job.instr_seq_flex, job.instr_seq_relay,
+                           job.cmd_flex, job.cmd_relay, job.addr_mapping}) {
+    if (!fs::is_regular_file(file)) {
+      ILA_ERROR << "Job " << job.name << ": " << file << " not found";
+      return false;
+    }
+  }
+  return true;
+}
+
+const std::pair<FlatIla, FlatIla>&
+ModelCache::Get(const std::vector<std::string>& passes) {
+  auto pos = models_.find(passes);
+  if (pos != models_.end()) {
+    return pos->second;
+  }
+
+  // model construction shares global state across threads
+  static std::mutex construct_mtx;
+  std::lock_guard<std::mutex> lock(construct_mtx);
+
+  ILA_INFO << "Building models for " << passes.size() << " passes";
+  auto flex = FlattenIla(flex::GetFlexIla());
+  auto relay = FlattenIla(relay::GetRelayIla());
+  std::vector<PassStat> stat;
+  ApplyPasses(flex.model, 0, passes, stat);
+  ApplyPasses(relay.model, 1, passes, stat);
+
+  return models_.emplace(passes, std::make_pair(flex, relay)).first->second;
+}
+
+std::string GetJobFingerprint(const Job& job) {
+  std::string content;
+  for (const auto& file : {job.instr_seq_flex, job.instr_seq_relay,
+                           job.cmd_flex, job.cmd_relay, job.addr_mapping}) {
+    std::ifstream fin(file);
+    content.append(std::istreambuf_iterator<char>(fin),
+                   std::istreambuf_iterator<char>());
+    content += "\n";
+  }
+  for (const auto& pass : job.passes) {
+    content += pass + "\n";
+  }
+  content += job.parametric_addr ? "parametric" : "concrete";
+  // the models are built in, so their revisions are part of the inputs
+#ifdef FLEX_REV
+  content += std::string("\nflex:") + FLEX_REV;
+#endif
+#ifdef RELAY_REV
+  content += std::string("\nrelay:") + RELAY_REV;
+#endif
+  return GetContentHash(content);
+}
+
+bool RunJob(const Job& job, CheckStat& stat, ModelCache* cache,
+            Journal* journal) {
+  ILA_INFO << "Running job " << job.name;
+
+#ifdef USE_Z3
+  z3::context ctx;
+  auto smt_generator = Z3ExprAdapter(ctx);
+#else
+  auto btor = smt::BoolectorSolverFactory::create(false);
+  btor->set_opt("incremental", "true");
+  btor->set_opt("produce-models", "true");
+  auto smt_generator = SmtSwitchItf(btor);
+#endif
+
+  typedef decltype(smt_generator) Generator;
+  auto smt_shim = SmtShim(smt_generator);
+
+  // warm models (passes applied) or a fresh pair
+  std::unique_ptr<IsCheckerFlexRelay<Generator>> checker;
+  if (cache) {
+    auto& [flex, relay] = cache->Get(job.passes);
+    checker =
+        std::make_unique<IsCheckerFlexRelay<Generator>>(flex, relay, smt_shim);
+  } else {
+    checker = std::make_unique<IsCheckerFlexRelay<Generator>>(smt_shim);
+    checker->SetPasses(job.passes);
+  }
+
+  // instruction sequence to verify
+  checker->SetInstrSeq(0, job.instr_seq_flex);
+  checker->SetInstrSeq(1, job.instr_seq_relay);
+
+  // design specific
+  checker->SetFlexCmd(job.cmd_flex);
+  checker->SetRelayCmd(job.cmd_relay);
+  checker->SetAddrMapping(job.addr_mapping);
+
+  // checking strategy
+  checker->SetParametricAddr(job.parametric_addr);
+  checker->SetCompositional(job.compositional);
+  checker->SetInduction(job.induction);
+  checker->SetMergeObligation(job.merge_obligations);
+  checker->SetSegmentThread(job.segment_thread);
+  checker->SetUnrollThread(job.unroll_thread);
+  checker->SetSatSolver(job.sat_solver, job.cnf_cache);
+  checker->SetCube(job.cube_bits, job.cube_thread);
+  checker->SetTimeout(job.timeout * 1000);
+  if (!job.incremental.empty()) {
+    checker->SetIncremental(job.incremental);
+  }
+
+  // campaign - records are invalidated by changing the inputs
+  if (journal) {
+    checker->SetJournal(journal, job.name + "@" + GetJobFingerprint(job));
+  }
+
+  // verify
+  auto res = checker->Check();
+  stat = checker->stat();
+
+  if (!job.stat_out.empty()) {
+    std::ofstream fout(job.stat_out);
+    fout << json{{"job", job.name}, {"stat", stat}}.dump(2);
+    fout.close();
+  }
+
+  return res;
+}
+
+json RunJobIsolated(
+    const Job& job,
+    const std::function<json(const bool&, const CheckStat&)>& report,
+    ModelCache* cache) {
+  // private to the process and thread (server workers fork concurrently)
+  auto tid = std::hash<std::thread::id>{}(std::this_thread::get_id());
+  auto out = fs::temp_directory_path() /
+             fmt::format("pffc_job_{}_{:x}_{}.json", getpid(), tid, job.name);
+
+  // warm models are built here, so the child starts from them
+  if (cache) {
+    cache->Get(job.passes);
+  }
+
+  auto pid = fork();
+  if (pid == 0) {
+    auto res = json();
+    try {
+      CheckStat stat;
+      auto verified = RunJob(job, stat, cache);
+      res = report(verified, stat);
+    } catch (const std::exception& e) {
+      ILA_ERROR << "Job " << job.name << " aborted: " << e.what();
+      _exit(1);
+    }
+    std::ofstream fout(out);
+    fout << res.dump();
+    fout.close();
+    _exit(0);
+  }
+
+  int status = 0;
+  if (pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+      WEXITSTATUS(status) != 0 || !fs::is_regular_file(out)) {
+    ILA_ERROR << "Job " << job.name << " did not complete";
+    fs::remove(out);
+    return json();
+  }
+
+  std::ifstream fin(out);
+  std::string content((std::istreambuf_iterator<char>(fin)),
+                      std::istreambuf_iterator<char>());
+  fin.close();
+  fs::remove(out);
+
+  auto res = json::parse(content, nullptr, false);
+  return res.is_discarded() ? json() : res;
+}
+
+} // namespace ilang
@@ -0,0 +1,110 @@
+// =============================================================================
+// MIT License
+//
+// Copyright (c) 2020 Princeton University
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+
+// File: journal.cc
+
+#include <fstream>
+
+#include <ilang/util/log.h>
+
+#include <pffc/journal.h>
+
+using json = nlohmann::json;
+
+namespace ilang {
+
+Journal::Journal(const fs::path& file) : file_(file) {
+  if (!fs::is_regular_file(file_)) {
+    ILA_INFO << "Start new journal " << file_;
+    return;
+  }
+
+  std::set<std::string> started;
+  std::ifstream fin(file_);
+  std::string line;
+  while (std::getline(fin, line)) {
+    // the last line may be cut off by a crash
+    auto entry = json::parse(line, nullptr, false);
+    if (entry.is_discarded() || !entry.is_object()) {
+      ILA_WARN << "Skip corrupted journal entry: " << line;
+      continue;
+    }
+
+    auto key = entry.value("key", "");
+    auto rec = Record{entry.value("result", ""), entry.value("time", 0.0),
+                      entry.value("witness", "")};
+    if (entry.value("event", "") == "start") {
+      started.insert(key);
+    } else if (IsConclusive(rec)) {
+      done_[key] = rec;
+    } else {
+      // e.g., timeout - checked again (possibly with a higher limit)
+      started.insert(key);
+    }
+  }
+  fin.close();
+
+  auto num_requeue = 0;
+  for (const auto& key : started) {
+    if (done_.find(key) == done_.end()) {
+      ILA_INFO << "Re-queue " << key;
+      num_requeue++;
+    }
+  }
+  ILA_INFO << "Resume journal " << file_ << ": " << done_.size()
+           << " finished, " << num_requeue << " re-queued";
+}
+
+const Journal::Record* Journal::Find(const std::string& key) const {
+  auto pos = done_.find(key);
+  return (pos == done_.end()) ? nullptr : &pos->second;
+}
+
+void Journal::Start(const std::string& key) {
+  Append({{"event", "start"}, {"key", key}});
+}
+
+void Journal::Done(const std::string& key, const Record& rec) {
+  Append({{"event", "done"},
+          {"key", key},
+          {"result", rec.result},
+          {"time", rec.time},
+          {"witness", rec.witness}});
+  if (IsConclusive(rec)) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    done_[key] = rec;
+  }
+}
+
+bool Journal::IsConclusive(const Record& rec) {
+  return rec.result == "sat" || rec.result == "unsat";
+}
+
+void Journal::Append(const json& entry) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  std::ofstream fout(file_, std::ios::app);
+  fout << entry.dump() << std::endl;
+}
+
+} // namespace ilang
@@ -0,0 +1,233 @@
+// =============================================================================
+// MIT License
+//
+// Copyright (c) 2020 Princeton University
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+
+// File: server.cc
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <thread>
+
+#include <ilang/util/log.h>
+#include <nlohmann/json.hpp>
+
+#include <pffc/server.h>
+
+using json = nlohmann::json;
+
+namespace ilang {
+
+// interval of scanning the queue directory
+static const auto k_poll_interval = std::chrono::milliseconds(200);
+// number of times a job is started before it is moved to failed
+static const int k_max_attempt = 3;
+
+// helper - record of the times the job file has been started (next to it)
+static fs::path GetAttemptFile(const fs::path& file) {
+  auto res = file;
+  return res.replace_extension(".attempt");
+}
+
+static int ReadAttempt(const fs::path& file) {
+  std::ifstream fin(GetAttemptFile(file));
+  auto attempt = 0;
+  fin >> attempt;
+  return attempt;
+}
+
+JobServer::JobServer(const fs::path& spool, const int& num_worker)
+    : spool_(spool), num_worker_(std::max(num_worker, 1)) {
+  for (auto dir : {"queue", "running", "done", "failed"}) {
+    fs::create_directories(spool_ / dir);
+  }
+
+  // jobs interrupted by a crash or reboot are queued again, unless they
+  // have been started too many times
+  std::vector<fs::path> files;
+  for (const auto& entry : fs::directory_iterator(spool_ / "running")) {
+    if (entry.path().extension() == ".json") {
+      files.push_back(entry.path());
+    }
+  }
+  for (const auto& file : files) {
+    auto attempt_file = GetAttemptFile(file);
+    auto dst = (ReadAttempt(file) < k_max_attempt) ? "queue" : "failed";
+    ILA_WARN << "Move interrupted job " << file.filename() << " to " << dst;
+    fs::rename(file, spool_ / dst / file.filename());
+    if (fs::exists(attempt_file)) {
+      fs::rename(attempt_file, spool_ / dst / attempt_file.filename());
+    }
+  }
+}
+
+void JobServer::Serve() {
+  ILA_INFO << "Serving " << spool_ << " with " << num_worker_ << " workers";
+
+  std::vector<std::thread> workers;
+  for (auto i = 0; i < num_worker_; i++) {
+    workers.emplace_back(&JobServer::Work, this, i);
+  }
+
+  while (!fs::exists(spool_ / "stop")) {
+    Poll();
+    std::this_thread::sleep_for(k_poll_interval);
+  }
+
+  // finish the running jobs, the queued ones stay in the queue directory
+  {
+    std::lock_guard<std::mutex> lock(queue_mtx_);
+    stop_ = true;
+  }
+  queue_cv_.notify_all();
+  for (auto& w : workers) {
+    w.join();
+  }
+
+  ILA_INFO << "Server stopped";
+}
+
+void JobServer::Poll() {
+  // queued but not yet moved to running (the workers remove them)
+  std::vector<fs::path> files;
+  {
+    std::lock_guard<std::mutex> lock(queue_mtx_);
+    for (const auto& entry : fs::directory_iterator(spool_ / "queue")) {
+      auto file = entry.path();
+      if (file.extension() == ".json" && known_.find(file) == known_.end()) {
+        files.push_back(file);
+      }
+    }
+  }
+  std::sort(files.begin(), files.end());
+
+  for (const auto& file : files) {
+    Job job;
+    try {
+      job = ReadJob(file);
+    } catch (const std::exception& e) {
+      ILA_ERROR << "Fail reading job " << file << ": " << e.what();
+      fs::rename(file, spool_ / "failed" / file.filename());
+      continue;
+    }
+
+    if (!HasJobInput(job)) {
+      fs::rename(file, spool_ / "failed" / file.filename());
+      continue;
+    }
+
+    // the spool is writable by the clients, so it does not name programs
+    if (!job.sat_solver.empty()) {
+      ILA_ERROR << "Job " << file << " names a SAT solver, not run by the "
+                << "server";
+      fs::rename(file, spool_ / "failed" / file.filename());
+      continue;
+    }
+
+    std::lock_guard<std::mutex> lock(queue_mtx_);
+    known_.insert(file);
+    queue_.push({job, file, seq_++, Timer()});
+    queue_cv_.notify_one();
+  }
+}
+
+void JobServer::Work(const int& id) {
+  ModelCache cache;
+
+  while (true) {
+    Entry entry;
+    {
+      std::unique_lock<std::mutex> lock(queue_mtx_);
+      queue_cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+      if (stop_) {
+        return;
+      }
+      entry = queue_.top();
+      queue_.pop();
+    }
+
+    auto wait = entry.enqueued.Elapsed();
+    auto running = spool_ / "running" / entry.file.filename();
+    auto attempt = ReadAttempt(entry.file) + 1;
+    try {
+      fs::rename(entry.file, running);
+      fs::remove(GetAttemptFile(entry.file));
+      std::ofstream fout(GetAttemptFile(running));
+      fout << attempt;
+    } catch (const fs::filesystem_error& e) {
+      // e.g., removed from the queue directory
+      ILA_ERROR << "Fail starting job " << entry.job.name << ": " << e.what();
+      running.clear();
+    }
+    {
+      // a job file of the same name can be queued again
+      std::lock_guard<std::mutex> lock(queue_mtx_);
+      known_.erase(entry.file);
+    }
+    if (running.empty()) {
+      continue;
+    }
+    entry.file = running;
+
+    // in a child process, so that a failing job does not stop the server
+    auto _report = [](const bool& verified, const CheckStat& stat) {
+      return json{{"verified", verified}, {"stat", stat}};
+    };
+    auto res = RunJobIsolated(entry.job, _report, &cache);
+    if (res.is_null()) {
+      res = {{"verified", false}, {"stat", {{"result", "error"}}}};
+    }
+
+    Report(entry, id, res.at("verified").get<bool>(), res.at("stat"), wait);
+  }
+}
+
+void JobServer::Report(const Entry& entry, const int& worker,
+                       const bool& verified, const json& stat,
+                       const double& wait) {
+  json res = {{"name", entry.job.name},
+              {"file", entry.file.filename().string()},
+              {"priority", entry.job.priority},
+              {"worker", worker},
+              {"wait", wait},
+              {"verified", verified},
+              {"stat", stat}};
+
+  auto done = spool_ / "done";
+  std::ofstream fout(done / (entry.file.stem().string() + ".result.json"));
+  fout << res.dump(2);
+  fout.close();
+  fs::rename(entry.file, done / entry.file.filename());
+  fs::remove(GetAttemptFile(entry.file));
+
+  // stream in the order of completion
+  std::lock_guard<std::mutex> lock(result_mtx_);
+  std::ofstream stream(spool_ / "results.jsonl", std::ios::app);
+  stream << res.dump() << std::endl;
+
+  ILA_INFO << "Job " << entry.job.name << " done: "
+           << stat.value("result", "") << " (" << stat.value("time", 0.0)
+           << " s, waited " << wait << " s)";
+}
+
+} // namespace ilang
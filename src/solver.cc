@@ -0,0 +1,153 @@
+// =============================================================================
+// MIT License
+//
+// Copyright (c) 2020 Princeton University
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+
+// File: solver.cc
+
+#include <ilang/target-smt/smt_switch_itf.h>
+#include <ilang/target-smt/z3_expr_adapter.h>
+#include <ilang/util/log.h>
+
+#include <pffc/solver.h>
+
+namespace ilang {
+
+#ifdef USE_Z3
+template class Solver<Z3ExprAdapter>;
+#else
+template class Solver<SmtSwitchItf>;
+#endif
+
+SolverStat DiffSolverStat(const SolverStat& before, const SolverStat& after) {
+  auto res = after;
+  for (auto& [key, value] : res) {
+    auto pos = before.find(key);
+    if (pos != before.end() && key.find("memory") == std::string::npos &&
+        value >= pos->second) {
+      value -= pos->second;
+    }
+  }
+  return res;
+}
+
+#ifdef USE_Z3
+
+template <class Generator>
+Solver<Generator>::Solver(SmtShim<Generator>& smt_gen, const unsigned& timeout)
+    : solver_(smt_gen.get().context()) {
+  if (timeout) {
+    solver_.set("timeout", timeout);
+  }
+}
+
+template <class Generator> Solver<Generator>::~Solver() {}
+
+template <class Generator> void Solver<Generator>::Add(const SmtExpr& expr) {
+  solver_.add(expr);
+}
+
+template <class Generator> SmtResult Solver<Generator>::Check() {
+  auto res = solver_.check();
+  if (res == z3::sat) {
+    return SmtResult::SAT;
+  }
+  return (res == z3::unsat) ? SmtResult::UNSAT : SmtResult::UNKNOWN;
+}
+
+template <class Generator> void Solver<Generator>::Push() { solver_.push(); }
+
+template <class Generator> void Solver<Generator>::Pop() { solver_.pop(); }
+
+template <class Generator>
+typename Solver<Generator>::SmtExpr
+Solver<Generator>::GetValue(const SmtExpr& expr) {
+  return solver_.get_model().eval(expr, true);
+}
+
+template <class Generator>
+std::string Solver<Generator>::ToString(const SmtExpr& expr) {
+  return expr.to_string();
+}
+
+template <class Generator> SolverStat Solver<Generator>::GetStatistics() {
+  return GetStatistics(solver_);
+}
+
+template <class Generator>
+SolverStat Solver<Generator>::GetStatistics(z3::solver& solver) {
+  SolverStat res;
+  auto stats = solver.statistics();
+  for (unsigned i = 0; i < stats.size(); i++) {
+    res[stats.key(i)] = stats.is_uint(i) ? stats.uint_value(i)
+                                         : stats.double_value(i);
+  }
+  return res;
+}
+
+#else // not USE_Z3
+
+// the shared solver is expected to be created in incremental mode
+template <class Generator>
+Solver<Generator>::Solver(SmtShim<Generator>& smt_gen, const unsigned& timeout)
+    : solver_(smt_gen.get().solver()) {
+  ILA_WARN_IF(timeout) << "Time limit not supported for smt-switch";
+  solver_->push();
+}
+
+template <class Generator> Solver<Generator>::~Solver() { solver_->pop(); }
+
+template <class Generator> void Solver<Generator>::Add(const SmtExpr& expr) {
+  solver_->assert_formula(expr);
+}
+
+template <class Generator> SmtResult Solver<Generator>::Check() {
+  auto res = solver_->check_sat();
+  if (res.is_sat()) {
+    return SmtResult::SAT;
+  }
+  return res.is_unsat() ? SmtResult::UNSAT : SmtResult::UNKNOWN;
+}
+
+template <class Generator> void Solver<Generator>::Push() { solver_->push(); }
+
+template <class Generator> void Solver<Generator>::Pop() { solver_->pop(); }
+
+template <class Generator>
+typename Solver<Generator>::SmtExpr
+Solver<Generator>::GetValue(const SmtExpr& expr) {
+  return solver_->get_value(expr);
+}
+
+template <class Generator>
+std::string Solver<Generator>::ToString(const SmtExpr& expr) {
+  return expr->to_string();
+}
+
+// smt-switch does not expose the statistics of the backend
+template <class Generator> SolverStat Solver<Generator>::GetStatistics() {
+  return {};
+}
+
+#endif // USE_Z3
+
+} // namespace ilang
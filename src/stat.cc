@@ -0,0 +1,169 @@
+// =============================================================================
+// MIT License
+//
+// Copyright (c) 2020 Princeton University
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+
+// File: stat.cc
+
+#include <sys/resource.h>
+
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#include <fmt/format.h>
+
+#include <pffc/stat.h>
+
+using json = nlohmann::json;
+
+namespace ilang {
+
+void to_json(json& j, const PassStat& stat) {
+  j = json{{"pass", stat.pass},
+           {"model", stat.model},
+           {"node_before", stat.node_before},
+           {"node_after", stat.node_after},
+           {"time", stat.time}};
+}
+
+void to_json(json& j, const QueryStat& stat) {
+  j = json{{"name", stat.name},
+           {"result", stat.result},
+           {"time", stat.time},
+           {"instr", stat.instr},
+           {"solver", stat.solver}};
+}
+
+void to_json(json& j, const CheckStat& stat) {
+  j = json{{"result", stat.result},
+           {"time", stat.time},
+           {"unroll_time", stat.unroll_time},
+           {"cnf_time", stat.cnf_time},
+           {"sat_time", stat.sat_time},
+           {"cnf_cache_hit", stat.cnf_cache_hit},
+           {"obligation_num", stat.obligation_num},
+           {"obligation_skipped", stat.obligation_skipped},
+           {"obligation_reused", stat.obligation_reused},
+           {"obligation_group", stat.obligation_group},
+           {"cube_num", stat.cube_num},
+           {"peak_mem", stat.peak_mem},
+           {"passes", stat.passes},
+           {"queries", stat.queries}};
+  for (auto i = 0; i < stat.node.size(); i++) {
+    j[fmt::format("node_m{}", i)] = stat.node.at(i);
+  }
+}
+
+std::string GetContentHash(const std::string& content) {
+  static const std::array<uint32_t, 64> k = {
+      0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+      0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+      0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+      0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+      0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+      0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+      0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+      0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+      0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+      0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+      0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+  std::array<uint32_t, 8> h = {0x6a09e667, 0xbb67ae85, 0x3c6ef372,
+                               0xa54ff53a, 0x510e527f, 0x9b05688c,
+                               0x1f83d9ab, 0x5be0cd19};
+
+  // SHA-256 padding: 0x80, zeros, and the length in bits (big-endian)
+  std::string msg = content;
+  uint64_t bits = static_cast<uint64_t>(content.size()) * 8;
+  msg.push_back(static_cast<char>(0x80));
+  while (msg.size() % 64 != 56) {
+    msg.push_back(0);
+  }
+  for (auto i = 7; i >= 0; i--) {
+    msg.push_back(static_cast<char>((bits >> (i * 8)) & 0xff));
+  }
+
+  auto _rotr = [](uint32_t x, int n) { return (x >> n) | (x << (32 - n)); };
+  for (size_t blk = 0; blk < msg.size(); blk += 64) {
+    std::array<uint32_t, 64> w;
+    for (auto i = 0; i < 16; i++) {
+      w.at(i) = 0;
+      for (auto j = 0; j < 4; j++) {
+        w.at(i) = (w.at(i) << 8) |
+                  static_cast<uint8_t>(msg.at(blk + i * 4 + j));
+      }
+    }
+    for (auto i = 16; i < 64; i++) {
+      auto s0 = _rotr(w.at(i - 15), 7) ^ _rotr(w.at(i - 15), 18) ^
+                (w.at(i - 15) >> 3);
+      auto s1 = _rotr(w.at(i - 2), 17) ^ _rotr(w.at(i - 2), 19) ^
+                (w.at(i - 2) >> 10);
+      w.at(i) = w.at(i - 16) + s0 + w.at(i - 7) + s1;
+    }
+
+    auto v = h;
+    for (auto i = 0; i < 64; i++) {
+      auto s1 = _rotr(v[4], 6) ^ _rotr(v[4], 11) ^ _rotr(v[4], 25);
+      auto ch = (v[4] & v[5]) ^ (~v[4] & v[6]);
+      auto t1 = v[7] + s1 + ch + k.at(i) + w.at(i);
+      auto s0 = _rotr(v[0], 2) ^ _rotr(v[0], 13) ^ _rotr(v[0], 22);
+      auto maj = (v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]);
+      auto t2 = s0 + maj;
+      v = {t1 + t2, v[0], v[1], v[2], v[3] + t1, v[4], v[5], v[6]};
+    }
+    for (auto i = 0; i < 8; i++) {
+      h.at(i) += v.at(i);
+    }
+  }
+
+  std::string digest;
+  for (const auto& word : h) {
+    digest += fmt::format("{:08x}", word);
+  }
+  return digest;
+}
+
+void ResetPeakMemory() {
+  // resets the peak (VmHWM) to the current resident set size
+  std::ofstream fout("/proc/self/clear_refs");
+  fout << "5";
+}
+
+size_t GetPeakMemory() {
+  std::ifstream fin("/proc/self/status");
+  std::string line;
+  while (std::getline(fin, line)) {
+    if (line.rfind("VmHWM:", 0) == 0) {
+      return std::stoul(line.substr(6));
+    }
+  }
+
+  // no procfs - peak of the process lifetime
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+  return usage.ru_maxrss;
+}
+
+} // namespace ilang
@@ -0,0 +1,66 @@
+// =============================================================================
+// MIT License
+//
+// Copyright (c) 2020 Princeton University
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+
+// File: t_bench.cc
+
+#include <gtest/gtest.h>
+
+#include <pffc/bench.h>
+
+namespace ilang {
+
+TEST(Bench, RegressedNode) {
+  // relative increase
+  BenchTolerance tol;
+  EXPECT_FALSE(IsRegressed("node_m0", 1000, 1100, tol));
+  EXPECT_TRUE(IsRegressed("node_m0", 1000, 1101, tol));
+  EXPECT_FALSE(IsRegressed("node_m1", 1000, 500, tol));
+}
+
+TEST(Bench, RegressedPeakMem) {
+  BenchTolerance tol;
+  EXPECT_FALSE(IsRegressed("peak_mem", 1000, 1300, tol));
+  EXPECT_TRUE(IsRegressed("peak_mem", 1000, 1301, tol));
+}
+
+TEST(Bench, RegressedTime) {
+  // both the ratio and the absolute difference
+  BenchTolerance tol;
+  EXPECT_TRUE(IsRegressed("time", 1.0, 1.6, tol));
+  EXPECT_FALSE(IsRegressed("time", 10.0, 14.0, tol));
+  // noise below the absolute difference
+  EXPECT_FALSE(IsRegressed("solve_time", 0.1, 0.5, tol));
+  EXPECT_FALSE(IsRegressed("sat_time", 0, 0.4, tol));
+  EXPECT_TRUE(IsRegressed("sat_time", 0, 0.6, tol));
+}
+
+TEST(Bench, RegressedTolerance) {
+  BenchTolerance tol;
+  tol.time = 3;
+  tol.min_time = 0;
+  EXPECT_FALSE(IsRegressed("unroll_time", 1.0, 2.9, tol));
+  EXPECT_TRUE(IsRegressed("unroll_time", 1.0, 3.1, tol));
+}
+
+} // namespace ilang
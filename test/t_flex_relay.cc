@@ -0,0 +1,73 @@
+// =============================================================================
+// MIT License
+//
+// Copyright (c) 2020 Princeton University
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+
+// File: t_flex_relay.cc
+
+#include <gtest/gtest.h>
+
+#include "util.h"
+
+namespace ilang {
+
+using AddrPairs = std::vector<std::pair<size_t, size_t>>;
+
+// helper - ranges as (flex_addr, relay_addr, size)
+static std::vector<std::tuple<size_t, size_t, size_t>>
+GetRange(const AddrPairs& pairs) {
+  std::vector<std::tuple<size_t, size_t, size_t>> res;
+  for (const auto& r : IsCheckerFlexRelayTest::GetAffineRange(pairs)) {
+    res.push_back({r.flex_addr, r.relay_addr, r.size});
+  }
+  return res;
+}
+
+TEST(FlexRelay, AffineRangeWhole) {
+  auto ranges = GetRange({{0x10, 0x100}, {0x11, 0x101}, {0x12, 0x102}});
+  ASSERT_EQ(ranges.size(), 1);
+  EXPECT_EQ(ranges.at(0), std::make_tuple(0x10, 0x100, 3));
+}
+
+TEST(FlexRelay, AffineRangeSplit) {
+  // gap in the Flex addresses
+  auto ranges =
+      GetRange({{0x10, 0x100}, {0x11, 0x101}, {0x20, 0x102}, {0x21, 0x103}});
+  ASSERT_EQ(ranges.size(), 2);
+  EXPECT_EQ(ranges.at(0), std::make_tuple(0x10, 0x100, 2));
+  EXPECT_EQ(ranges.at(1), std::make_tuple(0x20, 0x102, 2));
+
+  // jump in the Relay addresses
+  ranges = GetRange({{0x10, 0x100}, {0x11, 0x200}, {0x12, 0x201}});
+  ASSERT_EQ(ranges.size(), 2);
+  EXPECT_EQ(ranges.at(0), std::make_tuple(0x10, 0x100, 1));
+  EXPECT_EQ(ranges.at(1), std::make_tuple(0x11, 0x200, 2));
+}
+
+TEST(FlexRelay, AffineRangeIrregular) {
+  // reversed order, every address on its own
+  auto ranges = GetRange({{0x12, 0x102}, {0x11, 0x101}, {0x10, 0x100}});
+  EXPECT_EQ(ranges.size(), 3);
+  EXPECT_TRUE(GetRange({}).empty());
+}
+
+} // namespace ilang
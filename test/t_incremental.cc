@@ -0,0 +1,141 @@
+// =============================================================================
+// MIT License
+//
+// Copyright (c) 2020 Princeton University
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+
+// File: t_incremental.cc
+
+#include <unistd.h>
+
+#include <fstream>
+
+#include <fmt/format.h>
+#include <gtest/gtest.h>
+
+#include "util.h"
+
+namespace ilang {
+
+using RunState = IsCheckerTest::RunState;
+using StepSet = std::set<size_t>;
+
+// helper - state file removed with the test
+class RunStateTest : public ::testing::Test {
+protected:
+  fs::path file_;
+
+  void SetUp() override {
+    auto info = ::testing::UnitTest::GetInstance()->current_test_info();
+    file_ = fs::temp_directory_path() /
+            fmt::format("pffc_{}_{}.state", getpid(), info->name());
+    fs::remove(file_);
+  }
+  void TearDown() override { fs::remove(file_); }
+
+  void Write(const std::string& content) {
+    std::ofstream fout(file_);
+    fout << content;
+  }
+};
+
+TEST_F(RunStateTest, ReadMissing) {
+  auto state = IsCheckerTest::ReadRunState(file_);
+  EXPECT_TRUE(state.step.empty());
+  EXPECT_TRUE(state.extra.empty());
+  EXPECT_TRUE(state.verdict.empty());
+}
+
+TEST_F(RunStateTest, RoundTrip) {
+  RunState state;
+  state.step = {{"a", "b"}, {"c"}};
+  state.extra = {{"model:passes", "SIMPLIFY_SYNTACTIC;"}, {"mapping", "1"}};
+  state.verdict = {{"ob0", {"unsat", "q0"}}, {"ob1", {"sat", ""}}};
+  IsCheckerTest::WriteRunState(file_, state);
+
+  auto read = IsCheckerTest::ReadRunState(file_);
+  EXPECT_EQ(read.step, state.step);
+  EXPECT_EQ(read.extra, state.extra);
+  EXPECT_EQ(read.verdict, state.verdict);
+}
+
+TEST_F(RunStateTest, ReadCorrupted) {
+  Write(R"({"step": [["a"]], "extra": {}, "verd)");
+  EXPECT_TRUE(IsCheckerTest::ReadRunState(file_).step.empty());
+
+  // missing field
+  Write(R"({"step": [["a"]], "extra": {}})");
+  EXPECT_TRUE(IsCheckerTest::ReadRunState(file_).step.empty());
+
+  // a bad verdict drops the whole state
+  Write(R"({"step": [["a"]], "extra": {}, "verdict": {"ob0": {"result":)"
+        R"( "unsat"}}})");
+  auto state = IsCheckerTest::ReadRunState(file_);
+  EXPECT_TRUE(state.step.empty());
+  EXPECT_TRUE(state.verdict.empty());
+}
+
+TEST(RunState, DiffSameLength) {
+  RunState prev, curr;
+  prev.step = {{"a", "b", "c"}, {"d", "e"}};
+  curr.step = {{"a", "x", "c"}, {"d", "e"}};
+  auto [steps, extra] = IsCheckerTest::DiffRunState(prev, curr);
+  ASSERT_EQ(steps.size(), 2);
+  EXPECT_EQ(steps.at(0), StepSet({1}));
+  EXPECT_EQ(steps.at(1), StepSet());
+  EXPECT_TRUE(extra.empty());
+}
+
+TEST(RunState, DiffLengthChanged) {
+  // the steps after an insertion are shifted
+  RunState prev, curr;
+  prev.step = {{"a", "b", "c"}};
+  curr.step = {{"a", "x", "b", "c"}};
+  EXPECT_EQ(IsCheckerTest::DiffRunState(prev, curr).first.at(0),
+            StepSet({1, 2, 3}));
+
+  // appended steps only
+  curr.step = {{"a", "b", "c", "d"}};
+  EXPECT_EQ(IsCheckerTest::DiffRunState(prev, curr).first.at(0),
+            StepSet({3}));
+
+  // a model without previous run
+  curr.step = {{"a", "b", "c"}, {"d", "e"}};
+  auto steps = IsCheckerTest::DiffRunState(prev, curr).first;
+  EXPECT_EQ(steps.at(0), StepSet());
+  EXPECT_EQ(steps.at(1), StepSet({0, 1}));
+}
+
+TEST(RunState, DiffExtra) {
+  RunState prev, curr;
+  prev.extra = {{"same", "1"}, {"changed", "1"}, {"removed", "1"}};
+  curr.extra = {{"same", "1"}, {"changed", "2"}, {"added", "1"}};
+  auto extra = IsCheckerTest::DiffRunState(prev, curr).second;
+  EXPECT_EQ(extra, std::set<std::string>({"added", "changed", "removed"}));
+
+  // model identity, affecting all obligations (see GetAffected)
+  prev.extra = {{"model:flex", "abc"}};
+  curr.extra = {{"model:flex", "def"}};
+  extra = IsCheckerTest::DiffRunState(prev, curr).second;
+  EXPECT_EQ(extra, std::set<std::string>({"model:flex"}));
+}
+
+} // namespace ilang
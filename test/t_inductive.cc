@@ -0,0 +1,61 @@
+// =============================================================================
+// MIT License
+//
+// Copyright (c) 2020 Princeton University
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+
+// File: t_inductive.cc
+
+#include <gtest/gtest.h>
+
+#include "util.h"
+
+namespace ilang {
+
+using Periodic = std::tuple<size_t, size_t, size_t>;
+
+TEST(Inductive, FindPeriodicWhole) {
+  EXPECT_EQ(IsCheckerTest::FindPeriodic({1, 2, 1, 2, 1, 2}),
+            Periodic(0, 2, 3));
+  EXPECT_EQ(IsCheckerTest::FindPeriodic({5, 5, 5, 5}), Periodic(0, 1, 4));
+}
+
+TEST(Inductive, FindPeriodicPrefixSuffix) {
+  // setup and teardown steps around the loop
+  EXPECT_EQ(IsCheckerTest::FindPeriodic({9, 1, 2, 3, 1, 2, 3, 8}),
+            Periodic(1, 3, 2));
+  // partial last iteration is not counted
+  EXPECT_EQ(IsCheckerTest::FindPeriodic({1, 2, 1, 2, 1}), Periodic(0, 2, 2));
+}
+
+TEST(Inductive, FindPeriodicLongest) {
+  // the loop covering the most steps wins over the earlier one
+  EXPECT_EQ(IsCheckerTest::FindPeriodic({1, 1, 2, 3, 2, 3, 2, 3}),
+            Periodic(2, 2, 3));
+}
+
+TEST(Inductive, FindPeriodicNone) {
+  EXPECT_EQ(IsCheckerTest::FindPeriodic({}), Periodic(0, 0, 0));
+  EXPECT_EQ(IsCheckerTest::FindPeriodic({7}), Periodic(0, 0, 0));
+  EXPECT_EQ(IsCheckerTest::FindPeriodic({1, 2, 3, 4}), Periodic(0, 0, 0));
+}
+
+} // namespace ilang
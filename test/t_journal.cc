@@ -0,0 +1,133 @@
+// =============================================================================
+// MIT License
+//
+// Copyright (c) 2020 Princeton University
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+
+// File: t_journal.cc
+
+#include <unistd.h>
+
+#include <fstream>
+
+#include <fmt/format.h>
+#include <gtest/gtest.h>
+
+#include <pffc/journal.h>
+
+namespace ilang {
+
+// helper - journal file with the given lines, removed with the test
+class JournalTest : public ::testing::Test {
+protected:
+  fs::path file_;
+
+  void SetUp() override {
+    auto info = ::testing::UnitTest::GetInstance()->current_test_info();
+    file_ = fs::temp_directory_path() /
+            fmt::format("pffc_{}_{}.journal", getpid(), info->name());
+    fs::remove(file_);
+  }
+  void TearDown() override { fs::remove(file_); }
+
+  void Write(const std::vector<std::string>& lines) {
+    std::ofstream fout(file_);
+    for (const auto& line : lines) {
+      fout << line << "\n";
+    }
+  }
+};
+
+TEST_F(JournalTest, New) {
+  Journal journal(file_);
+  EXPECT_EQ(journal.num_done(), 0);
+  EXPECT_EQ(journal.Find("a"), nullptr);
+}
+
+TEST_F(JournalTest, ResumeFinished) {
+  Write({R"({"event": "start", "key": "a"})",
+         R"({"event": "done", "key": "a", "result": "unsat", "time": 1.5,)"
+         R"( "witness": ""})",
+         R"({"event": "start", "key": "b"})",
+         R"({"event": "done", "key": "b", "result": "sat", "time": 2,)"
+         R"( "witness": "data"})"});
+  Journal journal(file_);
+  EXPECT_EQ(journal.num_done(), 2);
+  ASSERT_NE(journal.Find("a"), nullptr);
+  EXPECT_EQ(journal.Find("a")->result, "unsat");
+  EXPECT_DOUBLE_EQ(journal.Find("a")->time, 1.5);
+  ASSERT_NE(journal.Find("b"), nullptr);
+  EXPECT_EQ(journal.Find("b")->witness, "data");
+}
+
+TEST_F(JournalTest, ResumeStartedOnly) {
+  // interrupted before done
+  Write({R"({"event": "start", "key": "a"})"});
+  Journal journal(file_);
+  EXPECT_EQ(journal.num_done(), 0);
+  EXPECT_EQ(journal.Find("a"), nullptr);
+}
+
+TEST_F(JournalTest, ResumeTruncated) {
+  // the last line cut off by a crash
+  Write({R"({"event": "start", "key": "a"})",
+         R"({"event": "done", "key": "a", "result": "unsat", "ti)"});
+  Journal journal(file_);
+  EXPECT_EQ(journal.num_done(), 0);
+  EXPECT_EQ(journal.Find("a"), nullptr);
+}
+
+TEST_F(JournalTest, ResumeUnknown) {
+  // e.g., timeout - checked again
+  Write({R"({"event": "start", "key": "a"})",
+         R"({"event": "done", "key": "a", "result": "unknown", "time": 9})"});
+  Journal journal(file_);
+  EXPECT_EQ(journal.num_done(), 0);
+  EXPECT_EQ(journal.Find("a"), nullptr);
+}
+
+TEST_F(JournalTest, DoneAppended) {
+  {
+    Journal journal(file_);
+    journal.Start("a");
+    journal.Done("a", {"unsat", 1, ""});
+    journal.Start("b");
+    journal.Done("b", {"unknown", 1, ""});
+    journal.Start("c");
+    EXPECT_EQ(journal.num_done(), 1);
+  }
+
+  Journal journal(file_);
+  EXPECT_EQ(journal.num_done(), 1);
+  ASSERT_NE(journal.Find("a"), nullptr);
+  EXPECT_EQ(journal.Find("a")->result, "unsat");
+  EXPECT_EQ(journal.Find("b"), nullptr);
+  EXPECT_EQ(journal.Find("c"), nullptr);
+}
+
+TEST(Journal, IsConclusive) {
+  EXPECT_TRUE(Journal::IsConclusive({"sat", 0, ""}));
+  EXPECT_TRUE(Journal::IsConclusive({"unsat", 0, ""}));
+  EXPECT_FALSE(Journal::IsConclusive({"unknown", 0, ""}));
+  EXPECT_FALSE(Journal::IsConclusive({"", 0, ""}));
+}
+
+} // namespace ilang
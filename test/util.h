@@ -0,0 +1,63 @@
+// =============================================================================
+// MIT License
+//
+// Copyright (c) 2020 Princeton University
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// =============================================================================
+
+// File: util.h
+
+#ifndef PFFC_TEST_UTIL_H__
+#define PFFC_TEST_UTIL_H__
+
+#include <ilang/target-smt/smt_switch_itf.h>
+#include <ilang/target-smt/z3_expr_adapter.h>
+
+#include <pffc/ischecker.h>
+#include <pffc/ischecker_flex_relay.h>
+
+namespace ilang {
+
+#ifdef USE_Z3
+using TestGenerator = Z3ExprAdapter;
+#else
+using TestGenerator = SmtSwitchItf;
+#endif
+
+// access to the helpers of the checker (never constructed)
+class IsCheckerTest : public IsChecker<TestGenerator> {
+public:
+  using IsChecker<TestGenerator>::FindPeriodic;
+  using IsChecker<TestGenerator>::RunState;
+  using IsChecker<TestGenerator>::DiffRunState;
+  using IsChecker<TestGenerator>::ReadRunState;
+  using IsChecker<TestGenerator>::WriteRunState;
+};
+
+// access to the helpers of the Flex/Relay checker (never constructed)
+class IsCheckerFlexRelayTest : public IsCheckerFlexRelay<TestGenerator> {
+public:
+  using IsCheckerFlexRelay<TestGenerator>::AddrRange;
+  using IsCheckerFlexRelay<TestGenerator>::GetAffineRange;
+};
+
+} // namespace ilang
+
+#endif // PFFC_TEST_UTIL_H__